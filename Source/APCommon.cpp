@@ -1,7 +1,6 @@
 #include <algorithm>
 #include <cmath>
 #include <limits>
-#include <unordered_map>
 
 #include "APCommon.h"
 
@@ -39,28 +38,3 @@ std::string floatToStringWithTwoDecimalPlaces(float value) {
     return stream.str();
 }
 
-
-ParameterQuery queryParameter(ParameterNames paramName, const std::string& parameterStringName) {
-
-    static const std::unordered_map<ParameterNames, ParameterQuery> paramNameMap = {
-        {ParameterNames::inGain,       { "inGain",       "Input Gain",      ParameterNames::inGain  }},
-        {ParameterNames::outGain,      { "outGain",      "Output Gain",     ParameterNames::outGain }},
-        {ParameterNames::selection,    { "selection",    "Saturation Type", ParameterNames::selection }},
-    };
-    
-    if (paramName != ParameterNames::END) {
-        auto it = paramNameMap.find(paramName);
-        if (it != paramNameMap.end()) return it->second;
-    }
-
-    static const std::unordered_map<std::string, ParameterNames> nameToEnumMap = {
-        {"inGain",        ParameterNames::inGain},
-        {"outGain",       ParameterNames::outGain},
-        {"selection",     ParameterNames::selection},
-    };
-    
-    auto strIt = nameToEnumMap.find(parameterStringName);
-    if (strIt != nameToEnumMap.end()) return queryParameter(strIt->second);
-
-    throw std::invalid_argument("Both enum and string queries failed for parameter for queryParameter");
-}
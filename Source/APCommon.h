@@ -1,11 +1,19 @@
 #pragma once
 
+#include <iterator>
 #include <map>
 #include <string>
 #include <JuceHeader.h>
 
+#include "Curves.h"
+
 #define DEBUG_MODE 0
 
+// Per-stage timing of processBlock, see Profiler.h. Off unless the build defines it
+#ifndef PROFILING_MODE
+#define PROFILING_MODE 0
+#endif
+
 
 enum class ButtonName {
     tanh,
@@ -22,45 +30,175 @@ enum class ButtonName {
     none
 };
 
+static_assert(numCurves == static_cast<int>(ButtonName::input), "Each curve in Curves.h needs a selection button");
+
 
 enum class ParameterNames {
     inGain,
     outGain,
     selection,
+    shaper,
+    adaa,
+    oversampling,
+    filter,
+    smoothing,
+    dcFilter,
+    adaptive,
+    multiband,
+    lowCrossover,
+    highCrossover,
+    // Per band, always low, mid and high in a row, see bandParameter
+    lowCurve,
+    midCurve,
+    highCurve,
+    lowDrive,
+    midDrive,
+    highDrive,
+    lowOutput,
+    midOutput,
+    highOutput,
+    model,
+    truePeak,
+    ceiling,
     END
 };
 
 
-struct ParameterQuery {
-    std::string id;
-    std::string label;
-    ParameterNames parameterEnum;
+enum class ShaperEngine {
+    polynomial,
+    linearTable,
+    cubicTable
+};
+
+
+enum class OversamplingFilter {
+    firEquiripple,
+    iirPolyphase,
+    iirLowLatency
+};
+
+
+enum class ADAAOrder {
+    off,
+    first,
+    second
+};
+
+
+// Curves with memory, see AnalogModels.h
+enum class AnalogModel {
+    off,
+    diodeClipper,
+    tapeHysteresis
+};
+
+
+enum class ParameterType {
+    floating,
+    choice
+};
+
+
+/**
+ * One entry of the parameter registry. Float parameters use the range and default,
+ * choice parameters the list of names with the default index in defaultValue.
+ */
+struct ParameterInfo {
+    ParameterNames name;
+    const char* id;
+    const char* label;
+    ParameterType type;
+    float minValue;
+    float maxValue;
+    float defaultValue;
+    const char* const* choices = nullptr;
+    int numChoices = 0;
+};
+
+
+inline constexpr const char* shaperChoices[]       = { "Polynomial", "Table (linear)", "Table (cubic)" };
+inline constexpr const char* adaaChoices[]         = { "Off", "1st order", "2nd order" };
+// Choice index is the number of 2x stages
+inline constexpr const char* oversamplingChoices[] = { "1x", "2x", "4x", "8x", "16x" };
+inline constexpr const char* filterChoices[]       = { "FIR equiripple", "IIR polyphase", "IIR low latency" };
+inline constexpr const char* dcFilterChoices[]     = { "Off", "5 Hz", "10 Hz", "20 Hz" };
+// DC blocker cutoff per dcFilter choice, 0 is off
+inline constexpr float dcFilterCutoffs[]           = { 0.0f, 5.0f, 10.0f, 20.0f };
+
+inline constexpr const char* modelChoices[]        = { "Off", "Diode clipper", "Tape hysteresis" };
+
+inline constexpr const char* switchChoices[]       = { "Off", "On" };
+
+static_assert(std::size(dcFilterChoices) == std::size(dcFilterCutoffs), "Each DC filter choice needs a cutoff");
+
+template <size_t size>
+constexpr ParameterInfo choiceParameter(ParameterNames name, const char* id, const char* label,
+                                        const char* const (&choices)[size], int defaultIndex) {
+    return { name, id, label, ParameterType::choice, 0, static_cast<float>(size - 1), static_cast<float>(defaultIndex), choices, static_cast<int>(size) };
+}
+
+template <size_t size>
+constexpr ParameterInfo choiceParameter(ParameterNames name, const char* id, const char* label,
+                                        const std::array<const char*, size>& choices, int defaultIndex) {
+    return { name, id, label, ParameterType::choice, 0, static_cast<float>(size - 1), static_cast<float>(defaultIndex), choices.data(), static_cast<int>(size) };
+}
+
+// In ParameterNames order, the APVTS layout is generated from this
+inline constexpr ParameterInfo parameterRegistry[] = {
+    { ParameterNames::inGain,    "inGain",    "Input Gain",  ParameterType::floating,   0.0f, 120.0f, 0.0f },
+    { ParameterNames::outGain,   "outGain",   "Output Gain", ParameterType::floating, -24.0f,   0.0f, 0.0f },
+    choiceParameter(ParameterNames::selection,    "selection",    "Saturation Type",     curveNames,          0),
+    choiceParameter(ParameterNames::shaper,       "shaper",       "Shaper Engine",       shaperChoices,       0),
+    choiceParameter(ParameterNames::adaa,         "adaa",         "ADAA",                adaaChoices,         0),
+    choiceParameter(ParameterNames::oversampling, "oversampling", "Oversampling",        oversamplingChoices, 3),
+    // Multiband always uses IIR low latency
+    choiceParameter(ParameterNames::filter,       "filter",       "Oversampling Filter", filterChoices,       0),
+    // Gain ramp time in ms
+    { ParameterNames::smoothing, "smoothing", "Smoothing",   ParameterType::floating,   0.0f, 500.0f, 50.0f },
+    choiceParameter(ParameterNames::dcFilter,     "dcFilter",     "DC Filter",           dcFilterChoices,     0),
+    // Skips oversampling while the curve is driven in its linear range, FIR filter only, see AdaptiveOversampling.h
+    choiceParameter(ParameterNames::adaptive,     "adaptive",     "Adaptive Oversampling", switchChoices,     0),
+    choiceParameter(ParameterNames::multiband,    "multiband",    "Multiband",           switchChoices,       0),
+    // Crossover frequencies in Hz
+    { ParameterNames::lowCrossover,  "lowCrossover",  "Low Crossover",  ParameterType::floating,   20.0f,  1000.0f,  200.0f },
+    { ParameterNames::highCrossover, "highCrossover", "High Crossover", ParameterType::floating, 1000.0f, 16000.0f, 3000.0f },
+    choiceParameter(ParameterNames::lowCurve,     "lowCurve",     "Low Curve",           curveNames,          0),
+    choiceParameter(ParameterNames::midCurve,     "midCurve",     "Mid Curve",           curveNames,          0),
+    choiceParameter(ParameterNames::highCurve,    "highCurve",    "High Curve",          curveNames,          0),
+    // Band drive and output in dB
+    { ParameterNames::lowDrive,   "lowDrive",   "Low Drive",   ParameterType::floating,   0.0f, 60.0f, 0.0f },
+    { ParameterNames::midDrive,   "midDrive",   "Mid Drive",   ParameterType::floating,   0.0f, 60.0f, 0.0f },
+    { ParameterNames::highDrive,  "highDrive",  "High Drive",  ParameterType::floating,   0.0f, 60.0f, 0.0f },
+    { ParameterNames::lowOutput,  "lowOutput",  "Low Output",  ParameterType::floating, -24.0f, 12.0f, 0.0f },
+    { ParameterNames::midOutput,  "midOutput",  "Mid Output",  ParameterType::floating, -24.0f, 12.0f, 0.0f },
+    { ParameterNames::highOutput, "highOutput", "High Output", ParameterType::floating, -24.0f, 12.0f, 0.0f },
+    // Replaces the curve on the single band path when on
+    choiceParameter(ParameterNames::model,        "model",        "Analog Model",        modelChoices,        0),
+    // Output ceiling on inter-sample peaks, in dBTP, see TruePeak.h
+    choiceParameter(ParameterNames::truePeak,     "truePeak",     "True Peak Ceiling",   switchChoices,       0),
+    { ParameterNames::ceiling, "ceiling", "Ceiling", ParameterType::floating, -12.0f, 0.0f, -1.0f },
 };
 
+constexpr bool isParameterRegistryOrdered() {
+    for (size_t i = 0; i < std::size(parameterRegistry); i++)
+        if (static_cast<size_t>(parameterRegistry[i].name) != i) return false;
+    return true;
+}
+
+static_assert(std::size(parameterRegistry) == static_cast<size_t>(ParameterNames::END), "Every parameter needs a registry entry");
+static_assert(isParameterRegistryOrdered(), "The parameter registry must follow the ParameterNames order");
+
+constexpr const ParameterInfo& getParameterInfo(ParameterNames name) {
+    return parameterRegistry[static_cast<size_t>(name)];
+}
+
+// The given band's (0 low, 1 mid, 2 high) parameter, from the low band's one
+constexpr ParameterNames bandParameter(ParameterNames low, int band) {
+    return static_cast<ParameterNames>(static_cast<int>(low) + band);
+}
+
 
 double linearToExponential(double linearValue, double minValue, double maxValue);
 float gainToDecibels(float gain);
 float decibelsToGain(float decibels);
 std::string floatToStringWithTwoDecimalPlaces(float value);
-ParameterQuery queryParameter(ParameterNames paramName, const std::string& parameterStringName = "");
-
-class APFont {
-public:
-    // TODO think of something against that memory leak
-    static juce::Font getFont() {
-        static juce::Font customTypeface = createFont();
-        return customTypeface;
-    }
-
-private:
-    static juce::Font createFont() {
-        auto typeface = juce::Typeface::createSystemTypefaceFor(
-            BinaryData::KnockoutFlyweight_otf, BinaryData::KnockoutFlyweight_otfSize);
-
-        if (typeface != nullptr) {
-            return juce::Font(juce::FontOptions(typeface));
-        }
-        
-        return juce::Font(juce::FontOptions(14.0f));
-    }
-};
@@ -0,0 +1,177 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <JuceHeader.h>
+
+/**
+ * Fixed-width pack of lanes, sized after juce::dsp::SIMDRegister so every operator
+ * below is a fixed trip-count loop that the compiler turns into one SSE/AVX/NEON
+ * instruction once inlined.
+ * SIMDRegister itself has no division, int/float conversion or shifts, all of which
+ * the polynomial kernels need. Width 1 is the scalar tail, so kernels are written once.
+ */
+template <typename Type, size_t Width>
+struct SIMDLanes {
+
+    static constexpr size_t width = Width;
+
+    using ElementType = Type;
+    using IntType = std::conditional_t<sizeof(Type) == 8, int64_t, int32_t>;
+    using MaskType = SIMDLanes<std::conditional_t<sizeof(Type) == 8, uint64_t, uint32_t>, Width>;
+
+    alignas(sizeof(Type) * Width) Type lane[Width];
+
+    SIMDLanes() = default;
+
+    SIMDLanes(Type scalar) {
+        for (size_t i = 0; i < Width; i++) lane[i] = scalar;
+    }
+
+    static SIMDLanes load(const Type* ptr) {
+        SIMDLanes r;
+        for (size_t i = 0; i < Width; i++) r.lane[i] = ptr[i];
+        return r;
+    }
+
+    void store(Type* ptr) const {
+        for (size_t i = 0; i < Width; i++) ptr[i] = lane[i];
+    }
+
+    Type operator[](size_t i) const { return lane[i]; }
+    Type& operator[](size_t i) { return lane[i]; }
+
+#define AP_LANES_BINARY_OP(op)                                              \
+    friend SIMDLanes operator op (SIMDLanes a, SIMDLanes b) {               \
+        SIMDLanes r;                                                        \
+        for (size_t i = 0; i < Width; i++) r.lane[i] = a.lane[i] op b.lane[i]; \
+        return r;                                                           \
+    }                                                                       \
+    SIMDLanes& operator op##= (SIMDLanes b) { return *this = *this op b; }
+
+#define AP_LANES_COMPARE_OP(op)                                             \
+    friend MaskType operator op (SIMDLanes a, SIMDLanes b) {                \
+        MaskType r;                                                         \
+        for (size_t i = 0; i < Width; i++)                                  \
+            r.lane[i] = a.lane[i] op b.lane[i] ? ~typename MaskType::ElementType(0) : 0; \
+        return r;                                                           \
+    }
+
+    AP_LANES_BINARY_OP(+)
+    AP_LANES_BINARY_OP(-)
+    AP_LANES_BINARY_OP(*)
+    AP_LANES_BINARY_OP(/)
+    AP_LANES_BINARY_OP(&)
+    AP_LANES_BINARY_OP(|)
+    AP_LANES_BINARY_OP(^)
+
+    AP_LANES_COMPARE_OP(<)
+    AP_LANES_COMPARE_OP(<=)
+    AP_LANES_COMPARE_OP(>)
+    AP_LANES_COMPARE_OP(>=)
+    AP_LANES_COMPARE_OP(==)
+
+#undef AP_LANES_BINARY_OP
+#undef AP_LANES_COMPARE_OP
+
+    friend SIMDLanes operator- (SIMDLanes a) {
+        SIMDLanes r;
+        for (size_t i = 0; i < Width; i++) r.lane[i] = -a.lane[i];
+        return r;
+    }
+
+    friend SIMDLanes operator>> (SIMDLanes a, int shift) {
+        SIMDLanes r;
+        for (size_t i = 0; i < Width; i++) r.lane[i] = a.lane[i] >> shift;
+        return r;
+    }
+
+    friend SIMDLanes operator<< (SIMDLanes a, int shift) {
+        SIMDLanes r;
+        for (size_t i = 0; i < Width; i++) r.lane[i] = a.lane[i] << shift;
+        return r;
+    }
+
+    friend SIMDLanes select(MaskType mask, SIMDLanes a, SIMDLanes b) {
+        SIMDLanes r;
+        for (size_t i = 0; i < Width; i++) r.lane[i] = mask.lane[i] ? a.lane[i] : b.lane[i];
+        return r;
+    }
+
+    friend SIMDLanes min(SIMDLanes a, SIMDLanes b) {
+        SIMDLanes r;
+        for (size_t i = 0; i < Width; i++) r.lane[i] = a.lane[i] < b.lane[i] ? a.lane[i] : b.lane[i];
+        return r;
+    }
+
+    friend SIMDLanes max(SIMDLanes a, SIMDLanes b) {
+        SIMDLanes r;
+        for (size_t i = 0; i < Width; i++) r.lane[i] = a.lane[i] > b.lane[i] ? a.lane[i] : b.lane[i];
+        return r;
+    }
+
+    friend SIMDLanes abs(SIMDLanes a) {
+        SIMDLanes r;
+        for (size_t i = 0; i < Width; i++) r.lane[i] = a.lane[i] < 0 ? -a.lane[i] : a.lane[i];
+        return r;
+    }
+
+    // Hardware square root, only vectorized when the compiler can drop errno handling
+    friend SIMDLanes sqrt(SIMDLanes a) {
+        SIMDLanes r;
+        for (size_t i = 0; i < Width; i++) r.lane[i] = std::sqrt(a.lane[i]);
+        return r;
+    }
+};
+
+template <typename Type, size_t Width>
+SIMDLanes<typename SIMDLanes<Type, Width>::IntType, Width> truncateToInt(SIMDLanes<Type, Width> a) {
+    SIMDLanes<typename SIMDLanes<Type, Width>::IntType, Width> r;
+    for (size_t i = 0; i < Width; i++) r.lane[i] = static_cast<typename SIMDLanes<Type, Width>::IntType>(a.lane[i]);
+    return r;
+}
+
+template <typename Type, typename IntType, size_t Width>
+SIMDLanes<Type, Width> toFloatingPoint(SIMDLanes<IntType, Width> a) {
+    SIMDLanes<Type, Width> r;
+    for (size_t i = 0; i < Width; i++) r.lane[i] = static_cast<Type>(a.lane[i]);
+    return r;
+}
+
+template <typename Type, size_t Width>
+SIMDLanes<typename SIMDLanes<Type, Width>::IntType, Width> toBits(SIMDLanes<Type, Width> a) {
+    SIMDLanes<typename SIMDLanes<Type, Width>::IntType, Width> r;
+    std::memcpy(r.lane, a.lane, sizeof(a.lane));
+    return r;
+}
+
+template <typename Type, typename IntType, size_t Width>
+SIMDLanes<Type, Width> fromBits(SIMDLanes<IntType, Width> a) {
+    static_assert(sizeof(Type) == sizeof(IntType), "bit cast between different lane sizes");
+    SIMDLanes<Type, Width> r;
+    std::memcpy(r.lane, a.lane, sizeof(a.lane));
+    return r;
+}
+
+// Per-lane table read, there is no portable gather instruction below AVX2
+template <typename Type, typename IntType, size_t Width>
+SIMDLanes<Type, Width> gather(const Type* base, SIMDLanes<IntType, Width> index) {
+    SIMDLanes<Type, Width> r;
+    for (size_t i = 0; i < Width; i++) r.lane[i] = base[index.lane[i]];
+    return r;
+}
+
+template <typename Type, size_t Width>
+SIMDLanes<Type, Width> floor(SIMDLanes<Type, Width> a) {
+    auto t = toFloatingPoint<Type>(truncateToInt(a));
+    return select(t > a, t - Type(1), t);
+}
+
+template <typename Type>
+using SIMDRegisterLanes = SIMDLanes<Type, juce::dsp::SIMDRegister<Type>::SIMDNumElements>;
+
+template <typename Type>
+using ScalarLanes = SIMDLanes<Type, 1>;
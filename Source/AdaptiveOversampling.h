@@ -0,0 +1,231 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <vector>
+#include <JuceHeader.h>
+
+#include "Curves.h"
+
+/**
+ * Skips the oversampler while the signal stays where the curve is practically a straight line.
+ *
+ * A curve is taken as linear up to the level where it strays from its slope at 0 by
+ * less than -100 dBFS : below that, whatever it could alias is under the same floor.
+ * That comes to about -30 dBFS for tanh, -28 for sine, -9 for hard, -44 for log, -49
+ * for squared sine, -94 for asym and -1 for fold, sqrt and cube never qualify.
+ * Once the driven input has stayed below that level for holdSeconds, the output fades
+ * over to a base rate path running the curve on the input delayed by the plugin's
+ * latency. A single louder sample fades straight back.
+ *
+ * Both paths only line up when the oversampler is linear phase with an integer delay,
+ * which the processor only enables this for (its FIR engine) : an IIR's phase varies
+ * with frequency and the mix would comb. The filters hold stale history after a linear
+ * stretch. When the way back starts they are reset and primed with the input that led
+ * up to the block, read back from the history, so the fade starts right away.
+ */
+class AdaptiveOversampling {
+public:
+    static constexpr double holdSeconds = .1;
+    static constexpr double fadeSeconds = .005;
+    // Delay kept for the base rate path, more latency than this leaves it switched off
+    static constexpr int maximumLatency = 4096;
+
+    // What the processor has to run for a block
+    struct Plan {
+        bool oversampled = true;
+        bool linear = false;
+        // The oversampler and ADAA history have to be cleared before use
+        bool reset = false;
+        // Weight of the oversampled path per sample, nullptr when only one path runs
+        const float* oversampledWeights = nullptr;
+    };
+
+    AdaptiveOversampling() {
+        for (size_t i = 0; i < thresholds.size(); i++)
+            thresholds[i] = computeLinearThreshold(curveRegistry[i].function);
+    }
+
+    void prepare(double sampleRate, size_t numChannels, int maximumBlockSize) {
+        holdSamples = juce::roundToInt(holdSeconds * sampleRate);
+        fadeSamples = std::max(1, juce::roundToInt(fadeSeconds * sampleRate));
+        maximumBlock = static_cast<size_t>(maximumBlockSize);
+
+        size_t capacity = 1;
+        while (capacity < maximumBlock + maximumLatency) capacity <<= 1;
+        mask = capacity - 1;
+
+        history.assign(numChannels, std::vector<double>(capacity, 0.0));
+        weights.assign(maximumBlock, 1.0f);
+        writePosition = 0;
+        path = Path::oversampled;
+        quietSamples = 0;
+    }
+
+    // Straight back to the oversampled path, the caller resets the oversampler
+    void reset() {
+        path = Path::oversampled;
+        quietSamples = 0;
+    }
+
+    // Input level up to which the curve counts as linear, 0 for anything else
+    float getThreshold(int selection) const {
+        return isCurve(selection) ? thresholds[static_cast<size_t>(selection)] : 0.0f;
+    }
+
+    /**
+     * Audio thread, once per block with the peak of the driven input, before push.
+     * Disabled or with a latency out of reach it fades back to oversampling and stays there,
+     * a block longer than announced has no room for the base rate path and jumps back.
+     */
+    Plan update(bool enabled, float peak, float threshold, int latency, size_t numSamples) {
+        Plan plan;
+
+        if (numSamples > maximumBlock) {
+            plan.reset = path == Path::linear;
+            path = Path::oversampled;
+            quietSamples = 0;
+            return plan;
+        }
+
+        const bool loud = !enabled || latency > maximumLatency || peak > threshold;
+        quietSamples = loud ? 0 : quietSamples + static_cast<int>(numSamples);
+
+        switch (path) {
+            case Path::oversampled:
+                if (quietSamples >= holdSamples + latency) start(Path::toLinear);
+                break;
+
+            case Path::linear:
+                if (loud) {
+                    start(Path::toOversampled);
+                    plan.reset = true;
+                }
+                break;
+
+            // Turning around halfway keeps the weights continuous
+            case Path::toLinear:
+                if (loud) {
+                    path = Path::toOversampled;
+                    fadePosition = fadeLength - fadePosition;
+                }
+                break;
+
+            case Path::toOversampled:
+                break;
+        }
+
+        plan.oversampled = path != Path::linear;
+        plan.linear = path != Path::oversampled;
+        if (plan.oversampled && plan.linear) plan.oversampledWeights = fillWeights(numSamples);
+
+        return plan;
+    }
+
+    // Every block while enabled, the driven input, gains multiply it when they aren't applied yet
+    template <typename Sample>
+    void push(const Sample* const* channels, size_t numChannels, size_t numSamples, const float* gains = nullptr) {
+        if (numSamples > maximumBlock) return;
+
+        for (size_t channel = 0; channel < std::min(numChannels, history.size()); channel++) {
+            double* line = history[channel].data();
+            const Sample* data = channels[channel];
+            for (size_t i = 0; i < numSamples; i++)
+                line[(writePosition + i) & mask] = gains == nullptr ? data[i] : static_cast<Sample>(data[i] * gains[i]);
+        }
+        writePosition = (writePosition + numSamples) & mask;
+    }
+
+    /**
+     * How much of the input before the block primes the reset filters, their tail in base
+     * rate samples as far as the history reaches. Read it with readDelayed before push.
+     */
+    size_t getPrimingLength(int tail) const {
+        return std::min(static_cast<size_t>(std::max(tail, 0)), mask + 1 - maximumBlock);
+    }
+
+    // The pushed input delayed by latency samples, for the block pushed last
+    template <typename Sample>
+    void readDelayed(Sample* const* destination, size_t numChannels, size_t numSamples, int latency) const {
+        const size_t start = writePosition - numSamples - static_cast<size_t>(latency);
+
+        for (size_t channel = 0; channel < std::min(numChannels, history.size()); channel++) {
+            const double* line = history[channel].data();
+            for (size_t i = 0; i < numSamples; i++)
+                destination[channel][i] = static_cast<Sample>(line[(start + i) & mask]);
+        }
+    }
+
+    // oversampled = oversampled * weight + linear * (1 - weight)
+    template <typename Sample>
+    static void mix(Sample* oversampled, const Sample* linear, const float* weight, size_t numSamples) {
+        for (size_t i = 0; i < numSamples; i++)
+            oversampled[i] = linear[i] + (oversampled[i] - linear[i]) * weight[i];
+    }
+
+private:
+    enum class Path {
+        oversampled,
+        toLinear,
+        linear,
+        toOversampled
+    };
+
+    std::array<float, numCurves> thresholds {};
+
+    Path path = Path::oversampled;
+    int quietSamples = 0;
+    int holdSamples = 0;
+    int fadeSamples = 1;
+    int fadeLength = 1;
+    int fadePosition = 0;
+
+    size_t maximumBlock = 0;
+    // Double, so double blocks read back what they pushed
+    std::vector<std::vector<double>> history;
+    size_t writePosition = 0;
+    size_t mask = 0;
+    std::vector<float> weights;
+
+    void start(Path fade) {
+        path = fade;
+        fadePosition = 0;
+        fadeLength = fadeSamples;
+    }
+
+    // Linear weights, the two paths carry the same signal so amplitudes have to add up to one
+    const float* fillWeights(size_t numSamples) {
+        const bool rising = path == Path::toOversampled;
+
+        for (size_t i = 0; i < numSamples; i++) {
+            const float progress = std::min(1.0f, static_cast<float>(fadePosition + static_cast<int>(i) + 1) / static_cast<float>(fadeLength));
+            weights[i] = rising ? progress : 1.0f - progress;
+        }
+
+        fadePosition += static_cast<int>(numSamples);
+        if (fadePosition >= fadeLength) path = rising ? Path::oversampled : Path::linear;
+
+        return weights.data();
+    }
+
+    /**
+     * Scans outwards from 0 in 2% steps until f(x) and f(-x) stray from the slope at 0
+     * by more than 1e-5. Curves without a finite slope at 0 come out close to 0.
+     */
+    static float computeLinearThreshold(float (*function)(float)) {
+        constexpr double tolerance = 1e-5;
+        constexpr double step = 1e-3;
+        const double slope = (static_cast<double>(function(static_cast<float>(step))) - function(static_cast<float>(-step))) / (2 * step);
+
+        double level = 0;
+        for (double x = 1e-6; x < 8; x *= 1.02) {
+            const double above = std::abs(function(static_cast<float>(x)) - slope * x);
+            const double below = std::abs(function(static_cast<float>(-x)) + slope * x);
+            if (above > tolerance || below > tolerance) break;
+            level = x;
+        }
+
+        return static_cast<float>(level);
+    }
+};
@@ -0,0 +1,267 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <vector>
+#include <JuceHeader.h>
+
+#include "APCommon.h"
+
+/**
+ * Worst case cost per sample of one channel at the oversampled rate, in TSC cycles,
+ * measured on a Xeon core with GCC -O2 (Benchmark's model/ cases report the same) :
+ *
+ *   diode clipper, table   :   ~50  (inputs under about +38 dB at 1x, +56 dB at 8x)
+ *   diode clipper, Newton  :  ~280  (past the table, every sample solved)
+ *   tape hysteresis        :  ~220  (fixed, two slope evaluations per sample)
+ *
+ * Each sample depends on the previous one, nothing vectorizes across time : a channel
+ * at 8x costs eight times that per base rate sample, ~1800 cycles for the tape.
+ *
+ * Both are fitted and tabulated in float like the curve kernels, double blocks pass
+ * through the same float computation.
+ */
+
+
+/**
+ * Diode clipper : a resistor into a capacitor with two antiparallel diodes across it,
+ *   C dv/dt = (u - v) / R - 2 Is sinh(v / Vt)
+ * Discretized with the trapezoidal rule, every sample comes down to solving
+ *   g(v) = v (1 + T a / 2) + T b / 2 sinh(v / Vt) = p,   p = s + T a / 2 u
+ * with a = 1 / RC, b = 2 Is / C, then s = 2 v - s for the next one.
+ *
+ * g only depends on the sample period and is monotonic, so its inverse is tabulated
+ * once per oversampling factor with the exact slopes 1 / g'(v) and read back with cubic
+ * Hermite interpolation. Past the table the diodes conduct hard : asinh(2 p / T b)
+ * lands a couple of mV above the root and two Newton steps, converging from above
+ * without overshoot, bring it under 1 uV. No sample ever iterates more than that.
+ */
+class DiodeClipper {
+public:
+    static constexpr double resistance = 2.2e3;
+    static constexpr double capacitance = 1e-8;
+    static constexpr double saturationCurrent = 2.52e-9;
+    static constexpr double thermalVoltage = .02585;
+
+    // Samples are taken as this many volts, the small signal gain stays 1
+    static constexpr float volts = .4f;
+
+    static constexpr float tableRange = 16;
+    static constexpr int tableSize = 4096;
+
+    // Not on the audio thread, solves tableSize + 1 points
+    void build(double sampleRate) {
+        const double period = 1 / sampleRate;
+        const double a = 1 / (resistance * capacitance);
+        const double b = 2 * saturationCurrent / capacitance;
+
+        linear = 1 + period * a / 2;
+        exponential = period * b / 2;
+        inputCoefficient = static_cast<float>(period * a / 2 * volts);
+
+        values.resize(tableSize + 1);
+        slopes.resize(tableSize + 1);
+        for (int i = 0; i <= tableSize; i++) {
+            const double p = tableRange * (2.0 * i / tableSize - 1);
+            const double v = solve(p);
+            values[static_cast<size_t>(i)] = static_cast<float>(v);
+            slopes[static_cast<size_t>(i)] = static_cast<float>(1 / derivative(v));
+        }
+    }
+
+    bool isBuilt() const { return !values.empty(); }
+
+    // In place, state is the channel's s
+    template <typename Sample>
+    void process(float& state, Sample* samples, size_t numSamples) const {
+        constexpr float step = 2 * tableRange / tableSize;
+        constexpr float inverseStep = 1 / step;
+        float s = state;
+
+        for (size_t i = 0; i < numSamples; i++) {
+            const float p = s + inputCoefficient * static_cast<float>(samples[i]);
+            const float v = std::abs(p) < tableRange ? interpolate(p, step, inverseStep) : solveConducting(p);
+            s = 2 * v - s;
+            samples[i] = v * (1 / volts);
+        }
+
+        state = s;
+    }
+
+private:
+    double linear = 1, exponential = 0;
+    float inputCoefficient = 0;
+    std::vector<float> values, slopes;
+
+    double evaluate(double v) const { return v * linear + exponential * std::sinh(v / thermalVoltage); }
+    double derivative(double v) const { return linear + exponential / thermalVoltage * std::cosh(v / thermalVoltage); }
+
+    /**
+     * g is odd and convex for v > 0, so Newton started above the root converges from above.
+     * Both terms of g are positive there, each alone bounds the root.
+     */
+    double solve(double p) const {
+        const double magnitude = std::abs(p);
+        double v = std::min(magnitude / linear, thermalVoltage * std::asinh(magnitude / exponential));
+
+        for (int iteration = 0; iteration < 100; iteration++) {
+            const double next = v - (evaluate(v) - magnitude) / derivative(v);
+            if (!(next < v)) break;
+            v = next;
+        }
+
+        return p < 0 ? -v : v;
+    }
+
+    float interpolate(float p, float step, float inverseStep) const {
+        const float position = (p + tableRange) * inverseStep;
+        const int index = std::min(static_cast<int>(position), tableSize - 1);
+        const float t = position - static_cast<float>(index);
+
+        const float y0 = values[static_cast<size_t>(index)], y1 = values[static_cast<size_t>(index) + 1];
+        const float m0 = slopes[static_cast<size_t>(index)] * step, m1 = slopes[static_cast<size_t>(index) + 1] * step;
+
+        // Cubic Hermite with the exact end slopes
+        const float t2 = t * t, t3 = t2 * t;
+        return y0 + m0 * t + (3 * (y1 - y0) - 2 * m0 - m1) * t2 + (2 * (y0 - y1) + m0 + m1) * t3;
+    }
+
+    float solveConducting(float p) const {
+        const double magnitude = std::abs(static_cast<double>(p));
+        double v = thermalVoltage * std::asinh(magnitude / exponential);
+
+        for (int iteration = 0; iteration < 2; iteration++) {
+            const double e = std::exp(v / thermalVoltage);
+            const double g = v * linear + exponential * (e - 1 / e) / 2 - magnitude;
+            v -= g / (linear + exponential / thermalVoltage * (e + 1 / e) / 2);
+        }
+
+        return static_cast<float>(p < 0 ? -v : v);
+    }
+};
+
+
+/**
+ * Tape magnetization M following the head's field H, after Jiles-Atherton as used in
+ * Chowdhury's real-time tape model. M remembers which way H last moved, which is the
+ * hysteresis loop : the irreversible part of dM/dH only pulls M towards the anhysteretic
+ * curve Ms L((H + alpha M) / a) in the direction H moves.
+ *
+ * dM/dH is integrated in H rather than time with one midpoint (RK2) step per sample,
+ * so nothing depends on the sample rate except the step size. Two slope evaluations,
+ * one exp each, and no iteration : the cost per sample is fixed.
+ */
+class TapeHysteresis {
+public:
+    // Normalized to Ms = 1 so the output stays within -1..1
+    static constexpr float a = 1 / 3.01f;
+    static constexpr float alpha = 1.6e-3f;
+    static constexpr float k = .47875f;
+    static constexpr float c = .697f;
+
+    // Hz, the DC blocker runs at least this high behind the model
+    static constexpr float playbackCutoff = 10;
+
+    struct State {
+        float m = 0, h = 0;
+    };
+
+    template <typename Sample>
+    static void process(State& state, Sample* samples, size_t numSamples) {
+        float m = state.m, h = state.h;
+
+        for (size_t i = 0; i < numSamples; i++) {
+            const float x = static_cast<float>(samples[i]);
+            const float dh = x - h;
+            const float direction = dh < 0 ? -1.0f : 1.0f;
+
+            const float k1 = slope(m, h, direction);
+            const float k2 = slope(m + dh * .5f * k1, h + dh * .5f, direction);
+
+            // One huge step can overshoot where the true M only approaches saturation
+            m = std::clamp(m + dh * k2, -1.0f, 1.0f);
+            h = x;
+            samples[i] = m;
+        }
+
+        state = { m, h };
+    }
+
+private:
+    // Langevin function L(x) = coth(x) - 1 / x and its derivative, series near 0 where both cancel
+    static void langevin(float x, float& value, float& derivative) {
+        const float x2 = x * x;
+        if (x2 < .09f) {
+            value = x * (1.0f / 3 - x2 / 45);
+            derivative = 1.0f / 3 - x2 / 15 + x2 * x2 * (2.0f / 189);
+            return;
+        }
+
+        // From e^-2|x| so nothing overflows, coth and 1 / sinh^2 share it
+        const float e = std::exp(-2 * std::abs(x));
+        const float inverse = 1 / (1 - e);
+        const float inverseX = 1 / x;
+        value = std::copysign((1 + e) * inverse, x) - inverseX;
+        derivative = inverseX * inverseX - 4 * e * inverse * inverse;
+    }
+
+    static float slope(float m, float h, float direction) {
+        float l, dl;
+        langevin((h + alpha * m) * (1 / a), l, dl);
+
+        const float difference = l - m;
+        const float irreversible = (difference > 0) == (direction > 0)
+                                 ? (1 - c) * difference / ((1 - c) * direction * k - alpha * difference)
+                                 : 0.0f;
+        const float reversible = c / a * dl;
+
+        return (irreversible + reversible) / (1 - c * alpha / a * dl);
+    }
+};
+
+
+/**
+ * Per channel state of both models and the diode tables for every oversampling factor,
+ * so a factor change only picks another table. Sized and built in prepare.
+ */
+class AnalogModels {
+public:
+    void prepare(double sampleRate, size_t numChannels, int maximumStages) {
+        diodes.resize(static_cast<size_t>(maximumStages) + 1);
+        for (size_t stages = 0; stages < diodes.size(); stages++)
+            diodes[stages].build(sampleRate * static_cast<double>(1 << stages));
+
+        diodeState.assign(numChannels, 0.0f);
+        tapeState.assign(numChannels, TapeHysteresis::State());
+        diode = &diodes.front();
+    }
+
+    void reset() {
+        std::fill(diodeState.begin(), diodeState.end(), 0.0f);
+        std::fill(tapeState.begin(), tapeState.end(), TapeHysteresis::State());
+    }
+
+    // Once per block, the factor of the stream process will run on
+    void setOversamplingFactor(size_t factor) {
+        size_t stages = 0;
+        while (stages + 1 < diodes.size() && (static_cast<size_t>(1) << stages) < factor) stages++;
+        diode = &diodes[stages];
+    }
+
+    template <typename Sample>
+    void process(AnalogModel model, size_t channel, Sample* samples, size_t numSamples) {
+        if (channel >= diodeState.size()) return;
+
+        if (model == AnalogModel::diodeClipper && diode != nullptr && diode->isBuilt())
+            diode->process(diodeState[channel], samples, numSamples);
+        else if (model == AnalogModel::tapeHysteresis)
+            TapeHysteresis::process(tapeState[channel], samples, numSamples);
+    }
+
+private:
+    std::vector<DiodeClipper> diodes;
+    const DiodeClipper* diode = nullptr;
+    std::vector<float> diodeState;
+    std::vector<TapeHysteresis::State> tapeState;
+};
@@ -8,7 +8,7 @@ const juce::String APSatur::getName() const { return JucePlugin_Name; }
 bool APSatur::acceptsMidi() const { return false; }
 bool APSatur::producesMidi() const { return false; }
 bool APSatur::isMidiEffect() const { return false; }
-double APSatur::getTailLengthSeconds() const { return 0.0; }
+double APSatur::getTailLengthSeconds() const { return getSampleRate() > 0 ? tailSamples / getSampleRate() : 0.0; }
 int APSatur::getNumPrograms() { return 1; }
 int APSatur::getCurrentProgram() { return 0; }
 void APSatur::setCurrentProgram(int index) { index; }
@@ -27,25 +27,34 @@ bool APSatur::hasEditor() const { return true; }
 
 void APSatur::releaseResources() {}
 
+// Any channel count from mono to immersive, as long as every output has its input
 bool APSatur::isBusesLayoutSupported(const BusesLayout& layouts) const {
-    layouts;
-    return true;
+    const auto& input = layouts.getMainInputChannelSet();
+    const auto& output = layouts.getMainOutputChannelSet();
+
+    if (output.isDisabled() || output.size() == 0) return false;
+
+    return input == output;
 }
 
 juce::AudioProcessorEditor* APSatur::createEditor() { return new GUI (*this); }
 
 void APSatur::getStateInformation (juce::MemoryBlock& destData) {
-    std::unique_ptr<juce::XmlElement> xml (apvts.state.createXml());
-    copyXmlToBinary (*xml, destData);
+    BinaryState::write(getParameterValues(), destData);
 }
 
+// Binary states, or the XML ones saved before them
 void APSatur::setStateInformation (const void* data, int sizeInBytes) {
-    std::unique_ptr<juce::XmlElement> xml (getXmlFromBinary (data, sizeInBytes));
-    if (xml != nullptr)
-    {
-        if (xml->hasTagName (apvts.state.getType()))
-        {
-            apvts.state = juce::ValueTree::fromXml (*xml);
-        }
+    ParameterValues values = getParameterValues();
+
+    bool loaded = BinaryState::read(data, sizeInBytes, values);
+    if (!loaded) {
+        std::unique_ptr<juce::XmlElement> xml (getXmlFromBinary (data, sizeInBytes));
+        loaded = xml != nullptr && readLegacyState(*xml, apvts.state.getType(), values);
     }
+    if (!loaded) return;
+
+    constrainValues(values);
+    slots.store(StateSlots::loadingSlot, values);
+    applyParameterValues(StateSlots::loadingSlot);
 }
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <array>
+#include <iterator>
+
+#include "Saturation.h"
+
+/**
+ * Every curve the plugin offers, in selection order. The entry is all there is to
+ * adding one : the processor instantiates its SIMD, table and ADAA kernels from the
+ * reference function (SIMDSaturation, TableSaturation and Antiderivative must be
+ * specialized for it or the build fails), the editor draws the same function and
+ * shows the formula picture from BinaryData. Double blocks run the double instantiation.
+ */
+struct CurveInfo {
+    const char* name;
+    float (*function)(float);
+    double (*doubleFunction)(double);
+    const char* formulaResource;
+};
+
+inline constexpr CurveInfo curveRegistry[] = {
+    { "Tanh",           doTanhStandard, doTanhStandard, "tanh_png" },
+    { "Sine",           doSine,         doSine,         "sine_png" },
+    { "Hard",           doHard,         doHard,         "hard_png" },
+    { "Log",            doLog,          doLog,          "log_png" },
+    { "Sqrt",           doSqrt,         doSqrt,         "sqrt_png" },
+    { "Cube",           doCube,         doCube,         "cube_png" },
+    { "Fold",           doFold,         doFold,         "fold_png" },
+    { "Squared sine",   doSquaredSine,  doSquaredSine,  "squaredSine_png" },
+    /**
+     * Placeholder until the curve has a picture of its own : Hard's formula is exactly
+     * its x >= 0 half, the negative half is Hard of -x^8.
+     */
+    { "Asymmetric exp", doAsym,         doAsym,         "hard_png" },
+};
+
+constexpr int numCurves = static_cast<int>(std::size(curveRegistry));
+
+constexpr bool isCurve(int selection) { return selection >= 0 && selection < numCurves; }
+
+// Names in selection order, for the selection parameter's choices
+constexpr std::array<const char*, numCurves> makeCurveNames() {
+    std::array<const char*, numCurves> names {};
+    for (int i = 0; i < numCurves; i++) names[static_cast<size_t>(i)] = curveRegistry[i].name;
+    return names;
+}
+
+inline constexpr std::array<const char*, numCurves> curveNames = makeCurveNames();
+
+// Carries a curve's functions as compile time constants into generic lambdas
+template <float (*Func)(float), double (*DoubleFunc)(double)>
+struct CurveTag {
+    static constexpr float (*function)(float) = Func;
+    static constexpr double (*doubleFunction)(double) = DoubleFunc;
+};
+
+// The double instantiation of a registry curve, from the float one kernels are keyed on
+template <float (*Func)(float)>
+constexpr double (*doubleFunctionOf())(double) {
+    for (const CurveInfo& curve : curveRegistry)
+        if (curve.function == Func) return curve.doubleFunction;
+    return nullptr;
+}
+
+/**
+ * Calls visitor(CurveTag<function, doubleFunction>()) for the selected curve, so the visitor can
+ * instantiate kernels for it. Nothing is called for an unknown selection.
+ */
+template <int index = 0, typename Visitor>
+void visitCurve(int selection, Visitor&& visitor) {
+    if constexpr (index < numCurves) {
+        if (selection == index)
+            visitor(CurveTag<curveRegistry[index].function, curveRegistry[index].doubleFunction>());
+        else
+            visitCurve<index + 1>(selection, visitor);
+    }
+}
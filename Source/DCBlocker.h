@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cmath>
+#include <vector>
+
+#include "APSIMD.h"
+
+/**
+ * First order DC blocking high-pass, y[n] = x[n] - x[n-1] + r * y[n-1] with
+ * r = exp(-2 pi fc / fs), 3 dB down at fc and flat above a few times fc.
+ *
+ * Like PolyphaseIIROversampler, channels are packed into the lanes of one register
+ * so the recursion runs once per sample for up to Lanes::width channels.
+ * A cutoff of 0 switches it off, callers check isEnabled and skip it entirely.
+ * Runs at the precision of the blocks it filters.
+ */
+template <typename Sample>
+class DCBlocker {
+public:
+    using Lanes = SIMDRegisterLanes<Sample>;
+
+    void prepare(double newSampleRate, size_t numChannels) {
+        sampleRate = newSampleRate;
+        state.assign((numChannels + Lanes::width - 1) / Lanes::width, State());
+        updateCoefficient();
+    }
+
+    // Turning it on starts from a clear history, the input passes unchanged at first
+    void setCutoff(float hz) {
+        if (hz == cutoff) return;
+
+        if (cutoff <= 0) reset();
+        cutoff = hz;
+        updateCoefficient();
+    }
+
+    bool isEnabled() const { return cutoff > 0; }
+
+    void reset() {
+        std::fill(state.begin(), state.end(), State());
+    }
+
+    Lanes processSample(size_t group, Lanes x) {
+        State& s = state[group];
+        const Lanes y = x - s.x1 + s.y1 * r;
+        s.x1 = x;
+        s.y1 = y;
+        return y;
+    }
+
+    // In place over whole channels, transposing a group of channels at a time
+    void process(Sample* const* channels, size_t numChannels, size_t numSamples) {
+        for (size_t g = 0; g < state.size() && g * Lanes::width < numChannels; g++) {
+            const size_t lanes = std::min(Lanes::width, numChannels - g * Lanes::width);
+
+            for (size_t n = 0; n < numSamples; n++) {
+                Lanes x(Sample(0));
+                for (size_t lane = 0; lane < lanes; lane++) x[lane] = channels[g * Lanes::width + lane][n];
+
+                const Lanes y = processSample(g, x);
+                for (size_t lane = 0; lane < lanes; lane++) channels[g * Lanes::width + lane][n] = y[lane];
+            }
+        }
+
+        flushDenormals();
+    }
+
+    /**
+     * The feedback decays towards zero forever once the input stops, through the
+     * denormal range where FTZ isn't available. Call once per block.
+     */
+    void flushDenormals() {
+        for (State& s : state)
+            for (size_t lane = 0; lane < Lanes::width; lane++)
+                if (std::abs(s.y1[lane]) < Sample(1e-15f)) s.y1[lane] = 0;
+    }
+
+private:
+    struct State {
+        Lanes x1 { Sample(0) }, y1 { Sample(0) };
+    };
+
+    double sampleRate = 44100;
+    float cutoff = 0;
+    Sample r = 1;
+    std::vector<State> state;
+
+    void updateCoefficient() {
+        r = static_cast<Sample>(std::exp(-2 * juce::MathConstants<double>::pi * cutoff / sampleRate));
+    }
+};
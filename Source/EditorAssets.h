@@ -0,0 +1,124 @@
+#pragma once
+
+#include <array>
+#include <vector>
+#include <JuceHeader.h>
+
+#include "Curves.h"
+
+/**
+ * Pictures and the typeface every open editor draws with, held through a
+ * juce::SharedResourcePointer : the first editor creates them, the last one to close
+ * frees them, however many instances a session has.
+ *
+ * Nothing is decoded before it's first drawn, the formula pictures one curve at a time.
+ * Each picture is also kept rendered at the size and pixel scale it's drawn at, so
+ * painting is a plain copy. Message thread only, like the editors using it.
+ */
+class EditorAssets {
+public:
+    juce::Font getFont() {
+        if (!typefaceLoaded) {
+            typefaceLoaded = true;
+            typeface = juce::Typeface::createSystemTypefaceFor(BinaryData::KnockoutFlyweight_otf,
+                                                               BinaryData::KnockoutFlyweight_otfSize);
+        }
+
+        return typeface != nullptr ? juce::Font(juce::FontOptions(typeface)) : juce::Font(juce::FontOptions(14.0f));
+    }
+
+    // The background filling bounds on a display with the given pixel scale
+    const juce::Image& getBackground(juce::Rectangle<int> bounds, float scale) {
+        for (const Rendered& rendered : backgrounds)
+            if (rendered.matches(bounds, scale)) return rendered.image;
+
+        if (!backgroundLoaded) {
+            backgroundLoaded = true;
+            background = juce::ImageFileFormat::loadFrom(BinaryData::saturation_png, BinaryData::saturation_pngSize);
+        }
+
+        // Editors can sit on displays with different scales, a few sizes are enough
+        if (backgrounds.size() == maximumRenderedBackgrounds) backgrounds.erase(backgrounds.begin());
+        backgrounds.push_back(render(bounds, scale, [this] (juce::Graphics& g, juce::Rectangle<float> area) {
+            if (background.isValid()) {
+                g.drawImage(background, area);
+            } else {
+                g.fillAll(juce::Colours::lightgrey);
+                g.setColour(juce::Colours::black);
+                g.setFont(24.0f);
+                g.drawFittedText("AP Mastering - Saturation Distortion: GUI error", area.toNearestInt(), juce::Justification::centredTop, 1);
+            }
+        }));
+
+        return backgrounds.back().image;
+    }
+
+    // The curve's formula centred in bounds, transparent around it, invalid for an unknown curve
+    const juce::Image& getFormula(int curve, juce::Rectangle<int> bounds, float scale) {
+        static const juce::Image none;
+        if (!isCurve(curve)) return none;
+
+        Formula& formula = formulas[static_cast<size_t>(curve)];
+        if (formula.rendered.matches(bounds, scale)) return formula.rendered.image;
+
+        if (!formula.loaded) {
+            formula.loaded = true;
+            int size = 0;
+            if (const char* data = BinaryData::getNamedResource(curveRegistry[curve].formulaResource, size))
+                formula.source = juce::ImageFileFormat::loadFrom(data, static_cast<size_t>(size));
+        }
+
+        formula.rendered = render(bounds, scale, [&formula] (juce::Graphics& g, juce::Rectangle<float> area) {
+            g.drawImageWithin(formula.source, 0, 0, juce::roundToInt(area.getWidth()), juce::roundToInt(area.getHeight()),
+                              juce::RectanglePlacement::xMid);
+        });
+
+        return formula.rendered.image;
+    }
+
+private:
+    static constexpr size_t maximumRenderedBackgrounds = 4;
+
+    struct Rendered {
+        juce::Image image;
+        int width = 0, height = 0;
+        float scale = 0;
+
+        bool matches(juce::Rectangle<int> bounds, float pixelScale) const {
+            return image.isValid() && width == bounds.getWidth() && height == bounds.getHeight() && scale == pixelScale;
+        }
+    };
+
+    struct Formula {
+        bool loaded = false;
+        juce::Image source;
+        Rendered rendered;
+    };
+
+    juce::Typeface::Ptr typeface;
+    bool typefaceLoaded = false;
+
+    juce::Image background;
+    bool backgroundLoaded = false;
+    std::vector<Rendered> backgrounds;
+
+    std::array<Formula, numCurves> formulas;
+
+    // Draws into an image of bounds' size at the pixel scale, draw(g, area) works in logical pixels from 0, 0
+    template <typename Draw>
+    static Rendered render(juce::Rectangle<int> bounds, float scale, Draw&& draw) {
+        Rendered rendered;
+        rendered.width = bounds.getWidth();
+        rendered.height = bounds.getHeight();
+        rendered.scale = scale;
+        rendered.image = juce::Image(juce::Image::ARGB,
+                                     std::max(1, juce::roundToInt(static_cast<float>(bounds.getWidth()) * scale)),
+                                     std::max(1, juce::roundToInt(static_cast<float>(bounds.getHeight()) * scale)),
+                                     true);
+
+        juce::Graphics g(rendered.image);
+        g.addTransform(juce::AffineTransform::scale(scale));
+        draw(g, bounds.withZeroOrigin().toFloat());
+        return rendered;
+    }
+};
@@ -0,0 +1,200 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <limits>
+#include <vector>
+#include <JuceHeader.h>
+
+/**
+ * Wait-free single producer, single consumer ring.
+ * push never blocks and drops the item when the consumer fell behind, pop returns
+ * false when there's nothing new. Each index is only written by its own side.
+ */
+template <typename T, size_t Capacity>
+class SPSCRing {
+    static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+    bool push(const T& item) {
+        const size_t write = writeIndex.load(std::memory_order_relaxed);
+        if (write - readIndex.load(std::memory_order_acquire) == Capacity) return false;
+
+        items[write & (Capacity - 1)] = item;
+        writeIndex.store(write + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool pop(T& item) {
+        const size_t read = readIndex.load(std::memory_order_relaxed);
+        if (read == writeIndex.load(std::memory_order_acquire)) return false;
+
+        item = items[read & (Capacity - 1)];
+        readIndex.store(read + 1, std::memory_order_release);
+        return true;
+    }
+
+private:
+    std::array<T, Capacity> items {};
+    std::atomic<size_t> writeIndex { 0 };
+    std::atomic<size_t> readIndex { 0 };
+};
+
+/**
+ * What the signal did over one frame, a millisecond of audio.
+ * Input is taken after the input gain, so it shows how hard the curve is driven.
+ * Mean squares are averaged over the frame and the channels, clips counts output
+ * samples above 0 dBFS.
+ */
+struct MeterFrame {
+    float inputMin = std::numeric_limits<float>::max(), inputMax = std::numeric_limits<float>::lowest(), inputMeanSquare = 0;
+    float outputMin = std::numeric_limits<float>::max(), outputMax = std::numeric_limits<float>::lowest(), outputMeanSquare = 0;
+    int clips = 0;
+};
+
+/**
+ * Audio side of the scope and meters : folds every block into MeterFrames and pushes
+ * the finished ones. A frame can straddle blocks, measureInput and measureOutput walk
+ * the same frame boundaries so both halves of a frame line up.
+ */
+class SignalMeter {
+public:
+    static constexpr double frameSeconds = .001;
+
+    // About a second of frames for the editor to catch up on
+    using Ring = SPSCRing<MeterFrame, 1024>;
+
+    void prepare(double sampleRate, int maximumBlockSize) {
+        samplesPerFrame = std::max(1, juce::roundToInt(sampleRate * frameSeconds));
+        maximumBlock = static_cast<size_t>(maximumBlockSize);
+        frames.assign(maximumBlock / static_cast<size_t>(samplesPerFrame) + 2, MeterFrame());
+        position = 0;
+    }
+
+    // With gains, measures channels * gains for when the input gain isn't applied to the buffer
+    template <typename Sample>
+    void measureInput(const Sample* const* channels, size_t numChannels, size_t numSamples, const float* gains = nullptr) {
+        if (!accepts(numChannels, numSamples)) return;
+
+        walk(numSamples, [&] (MeterFrame& frame, size_t offset, size_t length, bool starts) {
+            if (starts) frame = MeterFrame();
+            if (gains == nullptr)
+                accumulate(channels, numChannels, offset, length, frame.inputMin, frame.inputMax, frame.inputMeanSquare);
+            else
+                accumulateScaled(channels, gains, numChannels, offset, length, frame.inputMin, frame.inputMax, frame.inputMeanSquare);
+        });
+    }
+
+    // Call with the same block length as measureInput, finished frames go to the ring
+    template <typename Sample>
+    void measureOutput(const Sample* const* channels, size_t numChannels, size_t numSamples) {
+        if (!accepts(numChannels, numSamples)) return;
+
+        const size_t last = walk(numSamples, [&] (MeterFrame& frame, size_t offset, size_t length, bool) {
+            accumulate(channels, numChannels, offset, length, frame.outputMin, frame.outputMax, frame.outputMeanSquare);
+
+            for (size_t channel = 0; channel < numChannels; channel++)
+                for (size_t i = offset; i < offset + length; i++)
+                    frame.clips += std::abs(channels[channel][i]) > Sample(1);
+        });
+
+        finish(last, numChannels, numSamples);
+    }
+
+    // Both halves at once for a block known to be silent, without reading it
+    void measureSilence(size_t numChannels, size_t numSamples) {
+        if (!accepts(numChannels, numSamples)) return;
+
+        const size_t last = walk(numSamples, [&] (MeterFrame& frame, size_t, size_t, bool starts) {
+            if (starts) frame = MeterFrame();
+            frame.inputMin = std::min(frame.inputMin, 0.0f);
+            frame.inputMax = std::max(frame.inputMax, 0.0f);
+            frame.outputMin = std::min(frame.outputMin, 0.0f);
+            frame.outputMax = std::max(frame.outputMax, 0.0f);
+        });
+
+        finish(last, numChannels, numSamples);
+    }
+
+    // Read from the editor only, there must be a single consumer
+    Ring& getFrames() { return ring; }
+
+private:
+    int samplesPerFrame = 1;
+    size_t maximumBlock = 0;
+    int position = 0;
+    std::vector<MeterFrame> frames;
+    Ring ring;
+
+    // Pushes the frames before last, the unfinished one carries over to the next block
+    void finish(size_t last, size_t numChannels, size_t numSamples) {
+        const float scale = 1.0f / static_cast<float>(samplesPerFrame * static_cast<int>(numChannels));
+        for (size_t i = 0; i < last; i++) {
+            frames[i].inputMeanSquare *= scale;
+            frames[i].outputMeanSquare *= scale;
+            ring.push(frames[i]);
+        }
+
+        position = (position + static_cast<int>(numSamples)) % samplesPerFrame;
+        frames[0] = frames[last];
+    }
+
+    // Longer blocks than announced aren't metered rather than allocating
+    bool accepts(size_t numChannels, size_t numSamples) const {
+        return numChannels > 0 && numSamples > 0 && numSamples <= maximumBlock;
+    }
+
+    // Calls visit(frame, offset, length, startsFrame) per frame piece, returns the index of the unfinished frame
+    template <typename Visitor>
+    size_t walk(size_t numSamples, Visitor&& visit) {
+        size_t frame = 0, offset = 0;
+        int filled = position;
+
+        while (offset < numSamples) {
+            const size_t length = std::min(numSamples - offset, static_cast<size_t>(samplesPerFrame - filled));
+            visit(frames[frame], offset, length, filled == 0);
+
+            offset += length;
+            filled += static_cast<int>(length);
+            if (filled == samplesPerFrame) {
+                frame++;
+                filled = 0;
+            }
+        }
+
+        return frame;
+    }
+
+    template <typename Sample>
+    static void accumulate(const Sample* const* channels, size_t numChannels, size_t offset, size_t length,
+                           float& minimum, float& maximum, float& squares) {
+        for (size_t channel = 0; channel < numChannels; channel++) {
+            const Sample* data = channels[channel] + offset;
+            const auto range = juce::FloatVectorOperations::findMinAndMax(data, static_cast<int>(length));
+            minimum = std::min(minimum, static_cast<float>(range.getStart()));
+            maximum = std::max(maximum, static_cast<float>(range.getEnd()));
+
+            Sample sum = 0;
+            for (size_t i = 0; i < length; i++) sum += data[i] * data[i];
+            squares += static_cast<float>(sum);
+        }
+    }
+
+    template <typename Sample>
+    static void accumulateScaled(const Sample* const* channels, const float* gains, size_t numChannels, size_t offset,
+                                 size_t length, float& minimum, float& maximum, float& squares) {
+        for (size_t channel = 0; channel < numChannels; channel++) {
+            const Sample* data = channels[channel] + offset;
+            float sum = 0;
+            for (size_t i = 0; i < length; i++) {
+                const float x = static_cast<float>(data[i] * gains[offset + i]);
+                minimum = std::min(minimum, x);
+                maximum = std::max(maximum, x);
+                sum += x * x;
+            }
+            squares += sum;
+        }
+    }
+};
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <algorithm>
+#include <JuceHeader.h>
+
+constexpr int numBands = 3;
+
+/**
+ * Three band Linkwitz-Riley (4th order) crossover.
+ * The low band goes through an allpass at the high crossover so all three bands
+ * share the same phase response and add back up to a flat allpass.
+ *
+ * Bands are laid out band major, band b of channel c at bands[b * numChannels + c],
+ * so the oversampler sees every band of every channel as one more channel and packs
+ * them into its lanes together. Runs at the precision of the blocks it splits.
+ */
+template <typename Sample>
+class BandSplitter {
+public:
+    void prepare(double sampleRate, size_t numChannels, int maximumBlockSize) {
+        const juce::dsp::ProcessSpec spec { sampleRate, static_cast<juce::uint32>(maximumBlockSize),
+                                            static_cast<juce::uint32>(numChannels) };
+        lowSplit.prepare(spec);
+        highSplit.prepare(spec);
+        lowAllpass.prepare(spec);
+        lowAllpass.setType(juce::dsp::LinkwitzRileyFilter<Sample>::Type::allpass);
+        // The high crossover can't go past the band it splits
+        nyquist = static_cast<float>(sampleRate * .45);
+    }
+
+    void reset() {
+        lowSplit.reset();
+        highSplit.reset();
+        lowAllpass.reset();
+    }
+
+    void setCrossovers(float low, float high) {
+        high = std::min(std::max(high, low), nyquist);
+        lowSplit.setCutoffFrequency(low);
+        highSplit.setCutoffFrequency(high);
+        lowAllpass.setCutoffFrequency(high);
+    }
+
+    void split(const juce::dsp::AudioBlock<Sample>& input, Sample* const* bands) {
+        const size_t numChannels = input.getNumChannels();
+        const size_t numSamples = input.getNumSamples();
+
+        for (size_t channel = 0; channel < numChannels; channel++) {
+            const int index = static_cast<int>(channel);
+            const Sample* source = input.getChannelPointer(channel);
+            Sample* low = bands[channel];
+            Sample* mid = bands[numChannels + channel];
+            Sample* high = bands[2 * numChannels + channel];
+
+            for (size_t i = 0; i < numSamples; i++) {
+                Sample rest;
+                lowSplit.processSample(index, source[i], low[i], rest);
+                highSplit.processSample(index, rest, mid[i], high[i]);
+                low[i] = lowAllpass.processSample(index, low[i]);
+            }
+        }
+
+        lowSplit.snapToZero();
+        highSplit.snapToZero();
+        lowAllpass.snapToZero();
+    }
+
+    // Sums the bands back into output, which has as many channels and samples as the split input
+    static void join(const Sample* const* bands, juce::dsp::AudioBlock<Sample>& output) {
+        const size_t numChannels = output.getNumChannels();
+        const int numSamples = static_cast<int>(output.getNumSamples());
+
+        for (size_t channel = 0; channel < numChannels; channel++) {
+            Sample* destination = output.getChannelPointer(channel);
+            juce::FloatVectorOperations::copy(destination, bands[channel], numSamples);
+            for (size_t band = 1; band < numBands; band++)
+                juce::FloatVectorOperations::add(destination, bands[band * numChannels + channel], numSamples);
+        }
+    }
+
+private:
+    juce::dsp::LinkwitzRileyFilter<Sample> lowSplit, highSplit, lowAllpass;
+    float nyquist = 20000;
+};
@@ -0,0 +1,124 @@
+#include <cmath>
+
+#include "OversamplerHandoff.h"
+
+
+OversamplerHandoff::~OversamplerHandoff() {
+    delete current;
+    delete pending.exchange(nullptr);
+    delete retired.exchange(nullptr);
+}
+
+
+/**
+ * Decimates an impulse at each oversampled position of one base rate sample : between
+ * them every tap of the equivalent filter at the oversampled rate comes out once.
+ * Leaves the engine reset.
+ */
+template <typename Sample>
+static float measurePeakGain(OversamplerEngine& engine, size_t blockSize) {
+    const int length = static_cast<int>(std::ceil(engine.getLatency())) + engine.getTailSamples() + 1;
+    juce::AudioBuffer<Sample> buffer(1, static_cast<int>(blockSize));
+    double sum = 0;
+
+    for (size_t phase = 0; phase < engine.getFactor(); phase++) {
+        engine.reset();
+
+        for (int done = 0; done < length; done += buffer.getNumSamples()) {
+            buffer.clear();
+            juce::dsp::AudioBlock<Sample> block(buffer);
+            juce::dsp::AudioBlock<Sample> oversampled = engine.processSamplesUp(block);
+            if (done == 0) oversampled.setSample(0, static_cast<int>(phase), Sample(1));
+            engine.processSamplesDown(block);
+
+            for (int i = 0; i < buffer.getNumSamples(); i++) sum += std::abs(buffer.getSample(0, i));
+        }
+    }
+
+    engine.reset();
+    return static_cast<float>(sum);
+}
+
+
+template <typename Sample>
+void OversamplerHandoff::buildFilters(OversamplerEngine& engine) const {
+    auto& filters = engine.getFilters<Sample>();
+
+    if (engine.filter == FilterType::iirLowLatency) {
+        filters.polyphase = std::make_unique<PolyphaseIIROversampler<Sample>>(channels, engine.stages);
+        filters.polyphase->initProcessing(blockSize);
+    } else {
+        const auto type = engine.filter == FilterType::iirPolyphase
+                        ? juce::dsp::Oversampling<Sample>::filterHalfBandPolyphaseIIR
+                        : juce::dsp::Oversampling<Sample>::filterHalfBandFIREquiripple;
+
+        // Integer latency adds a small fractional delay so the host can compensate exactly
+        filters.oversampler = std::make_unique<juce::dsp::Oversampling<Sample>>(channels, static_cast<size_t>(engine.stages), type, true, true);
+        filters.oversampler->initProcessing(blockSize);
+    }
+
+    engine.peakGain = measurePeakGain<Sample>(engine, blockSize);
+}
+
+
+OversamplerEngine* OversamplerHandoff::build(int stages, FilterType filter) const {
+    auto* engine = new OversamplerEngine;
+    engine->stages = stages;
+    engine->filter = filter;
+
+    if (stages == 0) return engine;
+
+    if (doublePrecision) buildFilters<double>(*engine);
+    else buildFilters<float>(*engine);
+
+    return engine;
+}
+
+
+void OversamplerHandoff::prepare(int stages, FilterType filter, size_t numChannels, size_t maxBlockSize, bool useDouble) {
+    std::lock_guard<std::mutex> lock(buildLock);
+
+    channels = numChannels;
+    blockSize = maxBlockSize;
+    doublePrecision = useDouble;
+    requestedStages = stages;
+    requestedFilter = filter;
+
+    delete pending.exchange(nullptr);
+    delete retired.exchange(nullptr);
+    delete current;
+    current = build(stages, filter);
+}
+
+
+void OversamplerHandoff::request(int stages, FilterType filter) {
+    std::lock_guard<std::mutex> lock(buildLock);
+
+    if (channels == 0 || (stages == requestedStages && filter == requestedFilter)) return;
+
+    requestedStages = stages;
+    requestedFilter = filter;
+
+    // Whatever was still pending never reached the audio thread
+    delete pending.exchange(build(stages, filter), std::memory_order_acq_rel);
+}
+
+
+void OversamplerHandoff::collectGarbage() {
+    delete retired.exchange(nullptr, std::memory_order_acq_rel);
+}
+
+
+OversamplerEngine* OversamplerHandoff::acquire(bool& changed, bool swap) {
+    changed = false;
+
+    if (swap && isSwapPending()) {
+        if (OversamplerEngine* next = pending.exchange(nullptr, std::memory_order_acq_rel)) {
+            retired.store(current, std::memory_order_release);
+            current = next;
+            changed = true;
+        }
+    }
+
+    return current;
+}
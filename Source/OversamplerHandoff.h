@@ -0,0 +1,154 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+
+#include "APCommon.h"
+#include "PolyphaseIIR.h"
+
+/**
+ * One ready to run oversampling configuration, backed either by juce::dsp::Oversampling
+ * or by the low latency PolyphaseIIROversampler. At 1x there is neither and the
+ * block is processed in place.
+ *
+ * Filters are built for the precision the host processes in, the other set stays empty
+ * and blocks of that precision pass through untouched.
+ */
+struct OversamplerEngine {
+    template <typename Sample>
+    struct Filters {
+        std::unique_ptr<juce::dsp::Oversampling<Sample>> oversampler;
+        std::unique_ptr<PolyphaseIIROversampler<Sample>> polyphase;
+
+        bool isBuilt() const { return oversampler || polyphase; }
+
+        float getLatency() const {
+            if (oversampler) return oversampler->getLatencyInSamples();
+            if (polyphase) return polyphase->getLatencyInSamples();
+            return 0.0f;
+        }
+
+        juce::dsp::AudioBlock<Sample> processSamplesUp(juce::dsp::AudioBlock<Sample>& block) {
+            if (oversampler) return oversampler->processSamplesUp(block);
+            if (polyphase) return polyphase->processSamplesUp(block);
+            return block;
+        }
+
+        void processSamplesDown(juce::dsp::AudioBlock<Sample>& block) {
+            if (oversampler) oversampler->processSamplesDown(block);
+            if (polyphase) polyphase->processSamplesDown(block);
+        }
+
+        void reset() {
+            if (oversampler) oversampler->reset();
+            if (polyphase) polyphase->reset();
+        }
+    };
+
+    int stages = 0;
+    OversamplingFilter filter = OversamplingFilter::firEquiripple;
+    Filters<float> floats;
+    Filters<double> doubles;
+
+    /**
+     * Most the decimation can take the output above the oversampled stream's peak, the
+     * L1 norm of its impulse response at the oversampled rate, measured when the engine
+     * is built. Gibbs ringing of the clipped stream stays under peak times this. 1 at 1x.
+     */
+    float peakGain = 1;
+
+    size_t getFactor() const { return static_cast<size_t>(1) << stages; }
+
+    template <typename Sample>
+    Filters<Sample>& getFilters() {
+        if constexpr (std::is_same_v<Sample, float>) return floats;
+        else return doubles;
+    }
+
+    float getLatency() const { return floats.isBuilt() ? floats.getLatency() : doubles.getLatency(); }
+
+    /**
+     * Base rate samples the filters keep ringing for once the input stops.
+     * FIR half-bands are symmetric so twice their delay covers them, JUCE keeps its
+     * IIR coefficients to itself and gets a bound as long as a slow first stage of ours.
+     */
+    int getTailSamples() const {
+        if (floats.polyphase) return floats.polyphase->getTailSamples();
+        if (doubles.polyphase) return doubles.polyphase->getTailSamples();
+        if (!floats.oversampler && !doubles.oversampler) return 0;
+
+        const int delay = juce::roundToInt(2 * getLatency());
+        return filter == OversamplingFilter::firEquiripple ? delay : delay + 2048;
+    }
+
+    template <typename Sample>
+    juce::dsp::AudioBlock<Sample> processSamplesUp(juce::dsp::AudioBlock<Sample>& block) {
+        return getFilters<Sample>().processSamplesUp(block);
+    }
+
+    template <typename Sample>
+    void processSamplesDown(juce::dsp::AudioBlock<Sample>& block) {
+        getFilters<Sample>().processSamplesDown(block);
+    }
+
+    // Clears the filter history, allocation free
+    void reset() {
+        floats.reset();
+        doubles.reset();
+    }
+};
+
+/**
+ * Hands OversamplerEngines built on the message thread over to the audio thread.
+ *
+ * The audio thread only ever exchanges pointers : it picks up the pending engine
+ * and parks the one it replaces in the retired slot, which the message thread
+ * deletes later. A pending engine is only taken once the retired slot is empty,
+ * so nothing is ever freed or allocated on the audio thread and acquire() is wait-free.
+ */
+class OversamplerHandoff {
+public:
+    using FilterType = OversamplingFilter;
+
+    ~OversamplerHandoff();
+
+    // Message thread, replaces everything. Only call while the audio thread is stopped
+    void prepare(int stages, FilterType filter, size_t channels, size_t blockSize, bool doublePrecision = false);
+
+    // Message thread, builds a new engine unless it matches the latest one
+    void request(int stages, FilterType filter);
+
+    // Message thread, deletes the engine the audio thread let go of
+    void collectGarbage();
+
+    /**
+     * Audio thread, returns the engine to use for this block and whether it just changed.
+     * A waiting engine only takes over when swap is true. Returns nullptr before prepare.
+     */
+    OversamplerEngine* acquire(bool& changed, bool swap = true);
+
+    // Audio thread, whether an engine is waiting that acquire would swap in
+    bool isSwapPending() const {
+        return pending.load(std::memory_order_relaxed) != nullptr && retired.load(std::memory_order_acquire) == nullptr;
+    }
+
+private:
+    std::mutex buildLock;
+    size_t channels = 0, blockSize = 0;
+    bool doublePrecision = false;
+    int requestedStages = -1;
+    FilterType requestedFilter = FilterType::firEquiripple;
+
+    // Owned by the audio thread between prepare calls
+    OversamplerEngine* current = nullptr;
+
+    std::atomic<OversamplerEngine*> pending { nullptr };
+    std::atomic<OversamplerEngine*> retired { nullptr };
+
+    OversamplerEngine* build(int stages, FilterType filter) const;
+
+    template <typename Sample>
+    void buildFilters(OversamplerEngine& engine) const;
+};
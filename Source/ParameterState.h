@@ -0,0 +1,157 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <JuceHeader.h>
+
+#include "APCommon.h"
+
+constexpr size_t numParameters = static_cast<size_t>(ParameterNames::END);
+
+// Every parameter's value in its own units, choices by index, indexed by ParameterNames
+using ParameterValues = std::array<float, numParameters>;
+
+// Clamps each value into its parameter's range and choices onto an index, for values from outside
+inline void constrainValues(ParameterValues& values) {
+    for (const ParameterInfo& info : parameterRegistry) {
+        float& value = values[static_cast<size_t>(info.name)];
+        value = juce::jlimit(info.minValue, info.maxValue, value);
+        if (info.type == ParameterType::choice) value = std::round(value);
+    }
+}
+
+/**
+ * Binary plugin state, little endian :
+ *   int32 magic, int32 version, int32 count, then count float32 values in ParameterNames order.
+ *
+ * A parameter's index is its place in the blob, which holds as long as ParameterNames
+ * only grows at the end (the ParameterID versions rely on that too). A state from an
+ * older build has fewer values, the parameters added since keep what they had.
+ * Anything else, the XML states saved before this format included, starts with a
+ * different magic.
+ */
+struct BinaryState {
+    static constexpr int magic = 0x42535041; // "APSB"
+    static constexpr int version = 1;
+
+    static void write(const ParameterValues& values, juce::MemoryBlock& destination) {
+        juce::MemoryOutputStream stream(destination, false);
+        stream.writeInt(magic);
+        stream.writeInt(version);
+        stream.writeInt(static_cast<int>(values.size()));
+        for (float value : values) stream.writeFloat(value);
+    }
+
+    static bool isBinary(const void* data, int sizeInBytes) {
+        return sizeInBytes >= 12 && static_cast<int>(juce::ByteOrder::littleEndianInt(data)) == magic;
+    }
+
+    // Overwrites the values the blob holds, false and nothing changed if it's unreadable
+    static bool read(const void* data, int sizeInBytes, ParameterValues& values) {
+        if (!isBinary(data, sizeInBytes)) return false;
+
+        juce::MemoryInputStream stream(data, static_cast<size_t>(sizeInBytes), false);
+        stream.readInt();
+        if (stream.readInt() > version) return false;
+
+        const int count = stream.readInt();
+        if (count < 0 || stream.getNumBytesRemaining() < static_cast<juce::int64>(count) * 4) return false;
+
+        for (size_t i = 0; i < static_cast<size_t>(count); i++) {
+            const float value = stream.readFloat();
+            if (i < values.size() && std::isfinite(value)) values[i] = value;
+        }
+        return true;
+    }
+};
+
+/**
+ * The XML states saved by earlier versions : the APVTS tree, one PARAM child with id
+ * and value per parameter. Unknown ids are skipped, missing ones keep their value.
+ */
+inline bool readLegacyState(const juce::XmlElement& xml, const juce::Identifier& type, ParameterValues& values) {
+    if (!xml.hasTagName(type)) return false;
+
+    for (auto* child : xml.getChildWithTagNameIterator("PARAM")) {
+        const juce::String id = child->getStringAttribute("id");
+        for (const ParameterInfo& info : parameterRegistry)
+            if (id == info.id) {
+                const float value = static_cast<float>(child->getDoubleAttribute("value", values[static_cast<size_t>(info.name)]));
+                if (std::isfinite(value)) values[static_cast<size_t>(info.name)] = value;
+            }
+    }
+    return true;
+}
+
+
+/**
+ * Complete parameter sets kept in memory for A/B (up to numSlots) comparisons, plus
+ * one more used while a saved state loads.
+ *
+ * Recalling pushes the values to the parameters one by one on the message thread,
+ * which the audio thread could otherwise catch half way. Like a seqlock, beginRecall
+ * and endRecall make the sequence odd for the duration : a block whose parameter reads
+ * overlapped a recall takes every value from the recalled slot instead, which is what
+ * the parameters hold once it ends. Nothing allocates or locks on either side.
+ */
+class StateSlots {
+public:
+    static constexpr int numSlots = 4;
+    // Used by setStateInformation, not one of the user's slots
+    static constexpr int loadingSlot = numSlots;
+
+    // Message thread
+    void store(int slot, const ParameterValues& values) {
+        if (!isSlot(slot)) return;
+
+        for (size_t i = 0; i < numParameters; i++)
+            slots[static_cast<size_t>(slot)].values[i].store(values[i], std::memory_order_relaxed);
+        slots[static_cast<size_t>(slot)].stored.store(true, std::memory_order_release);
+    }
+
+    bool isStored(int slot) const {
+        return isSlot(slot) && slots[static_cast<size_t>(slot)].stored.load(std::memory_order_acquire);
+    }
+
+    // Message thread, the caller sets the parameters to load(slot) in between
+    void beginRecall(int slot) {
+        recalling.store(slot, std::memory_order_relaxed);
+        sequence.fetch_add(1, std::memory_order_acq_rel);
+    }
+
+    void endRecall() {
+        sequence.fetch_add(1, std::memory_order_acq_rel);
+    }
+
+    ParameterValues load(int slot) const {
+        ParameterValues values {};
+        if (isSlot(slot))
+            for (size_t i = 0; i < numParameters; i++)
+                values[i] = slots[static_cast<size_t>(slot)].values[i].load(std::memory_order_relaxed);
+        return values;
+    }
+
+    // Audio thread, readParameters(values) fills values from the parameters
+    template <typename Reader>
+    void read(ParameterValues& values, Reader&& readParameters) const {
+        const unsigned before = sequence.load(std::memory_order_acquire);
+        if ((before & 1) == 0) {
+            readParameters(values);
+            if (sequence.load(std::memory_order_acquire) == before) return;
+        }
+        values = load(recalling.load(std::memory_order_relaxed));
+    }
+
+private:
+    struct Slot {
+        std::array<std::atomic<float>, numParameters> values {};
+        std::atomic<bool> stored { false };
+    };
+
+    std::array<Slot, numSlots + 1> slots;
+    std::atomic<unsigned> sequence { 0 };
+    std::atomic<int> recalling { 0 };
+
+    static bool isSlot(int slot) { return slot >= 0 && slot <= numSlots; }
+};
@@ -2,44 +2,28 @@
 #include "PluginProcessor.h"
 
 
-std::unique_ptr<juce::RangedAudioParameter> newFloatParam(ParameterNames paramName,
-                                                          float minValue,
-                                                          float maxValue,
-                                                          float defaultValue) {
+std::unique_ptr<juce::RangedAudioParameter> newParameter(const ParameterInfo& info) {
     
-    ParameterQuery parameterQuery = queryParameter(paramName);
-    
-    return std::make_unique<juce::AudioParameterFloat>(juce::ParameterID(parameterQuery.id, static_cast<int>(paramName) + 1),
-                                                       parameterQuery.label,
-                                                       juce::NormalisableRange<float>(minValue, maxValue),
-                                                       defaultValue);
-}
+    const juce::ParameterID id(info.id, static_cast<int>(info.name) + 1);
 
+    if (info.type == ParameterType::choice)
+        return std::make_unique<juce::AudioParameterChoice>(id,
+                                                            info.label,
+                                                            juce::StringArray(info.choices, info.numChoices),
+                                                            static_cast<int>(info.defaultValue));
 
-std::unique_ptr<juce::RangedAudioParameter> newIntParam(ParameterNames paramName,
-                                                        int minValue,
-                                                        int maxValue,
-                                                        int defaultValue) {
-    
-    ParameterQuery parameterQuery = queryParameter(paramName);
-    
-    return std::make_unique<juce::AudioParameterInt>(juce::ParameterID(parameterQuery.id, static_cast<int>(paramName) + 1),
-                                                     parameterQuery.id,
-                                                     minValue,
-                                                     maxValue,
-                                                     defaultValue,
-                                                     juce::AudioParameterIntAttributes().withLabel(parameterQuery.label));
+    return std::make_unique<juce::AudioParameterFloat>(id,
+                                                       info.label,
+                                                       juce::NormalisableRange<float>(info.minValue, info.maxValue),
+                                                       info.defaultValue);
 }
 
-// TODO add oversampling and dc filter choice
 juce::AudioProcessorValueTreeState::ParameterLayout APSatur::createParameterLayout() {
     
     std::vector<std::unique_ptr<juce::RangedAudioParameter>> params;
 
-    params.push_back(newFloatParam(ParameterNames::inGain,     0.0f,    120.0f,     0.0f  ));
-    params.push_back(newFloatParam(ParameterNames::outGain,    -24.0f,   0.0f,     0.0f ));
-    // XXX this should be an AudioParameterChoice
-    params.push_back(newIntParam(ParameterNames::selection,     0,       8,         0     ));
+    for (const ParameterInfo& info : parameterRegistry)
+        params.push_back(newParameter(info));
 
     return { params.begin(), params.end() };
 }
@@ -4,28 +4,23 @@
 #include "APCommon.h"
 #include "PluginProcessor.h"
 #include "PluginEditor.h"
-#include "Saturation.h"
+#include "Curves.h"
+
+
+// Parameters the editor draws
+static constexpr ParameterNames listenedParameters[] = { ParameterNames::inGain, ParameterNames::outGain, ParameterNames::selection };
 
 
 GUI::GUI (APSatur& p)
 : AudioProcessorEditor (&p),
 audioProcessor (p),
-backgroundImage (juce::ImageFileFormat::loadFrom(BinaryData::saturation_png, BinaryData::saturation_pngSize)),
-tanhImage       (juce::ImageFileFormat::loadFrom(BinaryData::tanh_png, BinaryData::tanh_pngSize)),
-hardImage       (juce::ImageFileFormat::loadFrom(BinaryData::hard_png, BinaryData::hard_pngSize)),
-logImage        (juce::ImageFileFormat::loadFrom(BinaryData::log_png, BinaryData::log_pngSize)),
-foldImage       (juce::ImageFileFormat::loadFrom(BinaryData::fold_png, BinaryData::fold_pngSize)),
-squaredSineImage(juce::ImageFileFormat::loadFrom(BinaryData::squaredSine_png, BinaryData::squaredSine_pngSize)),
-sineImage       (juce::ImageFileFormat::loadFrom(BinaryData::sine_png, BinaryData::sine_pngSize)),
-sqrtImage       (juce::ImageFileFormat::loadFrom(BinaryData::sqrt_png, BinaryData::sqrt_pngSize)),
-cubeImage       (juce::ImageFileFormat::loadFrom(BinaryData::cube_png, BinaryData::cube_pngSize)),
-customTypeface (APFont::getFont()),
+customTypeface (assets->getFont()),
 inGainSlider(),
 outGainSlider(),
 selectionSlider(),
-inGainAttachment (std::make_unique<juce::AudioProcessorValueTreeState::SliderAttachment>(audioProcessor.apvts, "inGain", inGainSlider)),
-outGainAttachment (std::make_unique<juce::AudioProcessorValueTreeState::SliderAttachment>(audioProcessor.apvts, "outGain", outGainSlider)),
-selectionAttachment (std::make_unique<juce::AudioProcessorValueTreeState::SliderAttachment>(audioProcessor.apvts, "selection", selectionSlider)),
+inGainAttachment (std::make_unique<juce::AudioProcessorValueTreeState::SliderAttachment>(audioProcessor.apvts, getParameterInfo(ParameterNames::inGain).id, inGainSlider)),
+outGainAttachment (std::make_unique<juce::AudioProcessorValueTreeState::SliderAttachment>(audioProcessor.apvts, getParameterInfo(ParameterNames::outGain).id, outGainSlider)),
+selectionAttachment (std::make_unique<juce::AudioProcessorValueTreeState::SliderAttachment>(audioProcessor.apvts, getParameterInfo(ParameterNames::selection).id, selectionSlider)),
 currentButtonSelection(ButtonName::none) {
           
     for (size_t i = 0; i < sliders.size(); ++i) {
@@ -36,6 +31,9 @@ currentButtonSelection(ButtonName::none) {
         addAndMakeVisible(slider);
         slider.setVisible(false);
     }
+
+    for (ParameterNames name : listenedParameters)
+        audioProcessor.apvts.addParameterListener(getParameterInfo(name).id, this);
     
     setSize (460, 490);
     
@@ -47,28 +45,165 @@ currentButtonSelection(ButtonName::none) {
 GUI::~GUI() {
     
     stopTimer();
+
+    for (ParameterNames name : listenedParameters)
+        audioProcessor.apvts.removeParameterListener(getParameterInfo(name).id, this);
 }
 
 constexpr int granularity = 152;
 
+static const juce::Rectangle<int> inputTextBounds(ioColumn - ioRadius, ioRow1 - ioRadius, ioRadius * 2, ioRadius * 2);
+static const juce::Rectangle<int> outputTextBounds(ioColumn - ioRadius, ioRow2 - ioRadius, ioRadius * 2, ioRadius * 2);
+static const juce::Rectangle<int> selectionBounds(static_cast<int>(selectionColumn - selectionRadius) - 1,
+                                                  static_cast<int>(selectionFirstY - selectionRadius) - 1,
+                                                  static_cast<int>(selectionRadius * 2) + 2,
+                                                  static_cast<int>(selectionLastY - selectionFirstY + selectionRadius * 2) + 2);
+static const juce::Rectangle<int> equationBounds(mathL, mathT, mathR - mathL, mathB - mathT);
+// The curve stroke is 4 px wide
+static const juce::Rectangle<int> scopeBounds = juce::Rectangle<int>(scopeL, scopeT, scopeR - scopeL, scopeB - scopeT).expanded(2);
+#if PROFILING_MODE
+static const juce::Rectangle<int> profileBounds(4, 458, 452, 30);
+#endif
+
+
+constexpr double peakFallDecibelsPerSecond = 20;
+constexpr double meterIntegrationSeconds = .3;
+constexpr float meterFloorDecibels = -60, meterCeilingDecibels = 12;
+
+
+// Pulls every frame the audio thread published since the last tick, returns whether there were any
+bool GUI::drainMeter() {
+    static const float peakDecay = static_cast<float>(std::pow(10.0, -peakFallDecibelsPerSecond * SignalMeter::frameSeconds / 20));
+    static const float integration = static_cast<float>(1 - std::exp(-SignalMeter::frameSeconds / meterIntegrationSeconds));
+
+    MeterFrame frame;
+    bool received = false;
+
+    while (audioProcessor.getMeter().getFrames().pop(frame)) {
+        received = true;
+
+        scopeHistory[scopeWrite] = frame;
+        scopeWrite = (scopeWrite + 1) % scopeHistory.size();
+
+        inputPeak = std::max(inputPeak * peakDecay, std::max(-frame.inputMin, frame.inputMax));
+        outputPeak = std::max(outputPeak * peakDecay, std::max(-frame.outputMin, frame.outputMax));
+        inputMeanSquare += integration * (frame.inputMeanSquare - inputMeanSquare);
+        outputMeanSquare += integration * (frame.outputMeanSquare - outputMeanSquare);
+        clipCount += frame.clips;
+    }
+
+    return received;
+}
+
+
+void GUI::paintSignal(juce::Graphics& g) {
+    constexpr float scopeHeight = scopeB - scopeT;
+    constexpr float centre = scopeT + scopeHeight / 2;
+
+    // Same vertical scale as the transfer curve
+    const auto toY = [] (float value) {
+        return juce::jlimit(static_cast<float>(scopeT), static_cast<float>(scopeB), centre - value / 2.5f * scopeHeight);
+    };
+
+    for (size_t column = 0; column < scopeHistory.size(); column++) {
+        const MeterFrame& frame = scopeHistory[(scopeWrite + column) % scopeHistory.size()];
+        if (frame.inputMin > frame.inputMax) continue;
+
+        const int x = scopeL + static_cast<int>(column);
+
+        g.setColour(juce::Colours::white.withAlpha(0.2f));
+        g.drawVerticalLine(x, toY(frame.inputMax), toY(frame.inputMin) + 1);
+
+        g.setColour(juce::Colours::white.withAlpha(0.45f));
+        g.drawVerticalLine(x, toY(frame.outputMax), toY(frame.outputMin) + 1);
+    }
+
+    const auto toMeterY = [] (float gain) {
+        const float decibels = juce::jlimit(meterFloorDecibels, meterCeilingDecibels, gainToDecibels(gain));
+        return scopeB - (decibels - meterFloorDecibels) / (meterCeilingDecibels - meterFloorDecibels) * scopeHeight;
+    };
+
+    const std::pair<float, float> meters[] = {
+        { inputPeak, std::sqrt(inputMeanSquare) },
+        { outputPeak, std::sqrt(outputMeanSquare) },
+    };
+
+    float x = scopeR - 9.0f;
+    for (const auto& meter : meters) {
+        g.setColour(juce::Colours::white.withAlpha(0.3f));
+        g.fillRect(x, toMeterY(meter.first), 3.0f, scopeB - toMeterY(meter.first));
+        g.setColour(juce::Colours::white.withAlpha(0.7f));
+        g.fillRect(x, toMeterY(meter.second), 3.0f, scopeB - toMeterY(meter.second));
+        x += 5;
+    }
+
+    if (clipCount > 0) {
+        g.setColour(juce::Colours::red.withAlpha(0.8f));
+        g.setFont(12.0f);
+        g.drawText("clip " + juce::String(clipCount), scopeL + 3, scopeT + 2, 80, 14, juce::Justification::topLeft);
+    }
+}
+
+
+void GUI::updateCurvePath(int selection, float inputGain, float outputGain) {
+    if (selection == curveSelection && inputGain == curveInputGain && outputGain == curveOutputGain) return;
+
+    curveSelection = selection;
+    curveInputGain = inputGain;
+    curveOutputGain = outputGain;
+
+    constexpr int scopeWidth = scopeR - scopeL;
+    constexpr int scopeHeight = scopeB - scopeT;
+
+    constexpr float grainWidth = scopeWidth / static_cast<float>(granularity);
+
+    float (*curve)(float) = isCurve(selection) ? curveRegistry[selection].function : nullptr;
+
+    curvePath.clear();
+    axisPath.clear();
+    
+    for (int i = 0; i < granularity; ++i) {
+        float y = scopeB - scopeHeight * 0.5f;
+        float sample = inputGain * (i - granularity * 0.5f) / 20.f;
+
+        if (curve != nullptr) sample = curve(sample);
+        
+        y += sample * outputGain / 2.5f * scopeHeight;
+        
+        if (y < scopeT) y = scopeT;
+        if (y > scopeB) y = scopeB;
+        
+        if (i == 0) {
+            curvePath.startNewSubPath(scopeL, y);
+            axisPath.startNewSubPath(scopeL, scopeT + (scopeB - scopeT) / 2);
+            
+            continue;
+        }
+ 
+        curvePath.lineTo(scopeL + (i * grainWidth), y);
+        axisPath.lineTo(scopeL + (i * grainWidth), scopeT + (scopeB - scopeT) / 2);
+    }
+}
+
 void GUI::paint (juce::Graphics& g) {
     
-    if (backgroundImage.isValid()) {
-        g.drawImage(backgroundImage, getLocalBounds().toFloat());
-    } else {
-        g.fillAll(juce::Colours::lightgrey);
-        g.setColour (juce::Colours::black);
-        g.setFont (24.0f);
-        g.drawFittedText ("AP Mastering - Saturation Distortion: GUI error", getLocalBounds(), juce::Justification::centredTop, 1);
+    // Pictures come rendered at this pixel scale, drawing them is a plain copy
+    const float scale = g.getInternalContext().getPhysicalPixelScaleFactor();
+    g.drawImage(assets->getBackground(getLocalBounds(), scale), getLocalBounds().toFloat());
+
+   #if PROFILING_MODE
+    if (g.clipRegionIntersects(profileBounds)) {
+        g.setColour(juce::Colours::white.withAlpha(0.8f));
+        g.setFont(10.0f);
+        g.drawFittedText(profileText, profileBounds, juce::Justification::bottomLeft, 3);
     }
+   #endif
             
     g.setColour(juce::Colours::white.withAlpha(0.4f));
     
-    const int selection = static_cast<int>(audioProcessor.getFloatKnobValue(ParameterNames::selection));
+    const int selection = audioProcessor.getChoiceIndex(ParameterNames::selection);
 
-    if (selection >= static_cast<int>(ButtonName::none)) return;
-    
-    if (selection < 0) return;
+    if (!isCurve(selection)) return;
     
     g.fillEllipse(selectionColumn - selectionRadius,
                   selectionFirstY - selectionRadius + spacingY * selection,
@@ -85,188 +220,65 @@ void GUI::paint (juce::Graphics& g) {
     g.setFont(customTypeface);
     g.setColour (juce::Colours::white.withAlpha(0.6f));
 
-    g.drawFittedText(inputGainText,
-                     ioColumn - ioRadius,
-                     ioRow1 - ioRadius,
-                     ioRadius * 2,
-                     ioRadius * 2,
-                     juce::Justification::centred,
-                     1);
+    if (g.clipRegionIntersects(inputTextBounds))
+        g.drawFittedText(inputGainText, inputTextBounds, juce::Justification::centred, 1);
     
-    g.drawFittedText(outputGainText,
-                     ioColumn - ioRadius,
-                     ioRow2 - ioRadius,
-                     ioRadius * 2,
-                     ioRadius * 2,
-                     juce::Justification::centred,
-                     1);
+    if (g.clipRegionIntersects(outputTextBounds))
+        g.drawFittedText(outputGainText, outputTextBounds, juce::Justification::centred, 1);
 
-    constexpr int scopeWidth = scopeR - scopeL;
-    constexpr int scopeHeight = scopeB - scopeT;
+    if (g.clipRegionIntersects(scopeBounds)) {
+        paintSignal(g);
+        updateCurvePath(selection, audioProcessor.getInputGain(), audioProcessor.getOutputGain());
 
-    constexpr float grainWidth = scopeWidth / static_cast<float>(granularity);
+        g.setColour(juce::Colours::black.withAlpha(0.7f));
+        g.strokePath(curvePath, juce::PathStrokeType(4.0f));
+        g.strokePath(axisPath, juce::PathStrokeType(2.0f));
+    }
 
-    g.setColour(juce::Colours::black.withAlpha(0.7f));
+    if (!g.clipRegionIntersects(equationBounds)) return;
     
-    juce::Path path;
-    juce::Path path2;
+    g.drawImage(assets->getFormula(selection, equationBounds, scale), equationBounds.toFloat());
+}
 
-    const float iGain = audioProcessor.getInputGain(), oGain = audioProcessor.getOutputGain();
-    
-    for (int i = 0; i < granularity; ++i) {
-        float y = scopeB - scopeHeight * 0.5f;
-        float sample = iGain * (i - granularity * 0.5f) / 20.f;
-
-        // TODO put the switch outside of the loop
-        switch (selection) {
-            case static_cast<int>(ButtonName::tanh):
-                sample = doTanhStandard(sample);
-                break;
-                
-            case static_cast<int>(ButtonName::sine):
-                sample = doSine(sample);
-                break;
-                
-            case static_cast<int>(ButtonName::hard):
-                sample = doHard(sample);
-                break;
-                
-            case static_cast<int>(ButtonName::log):
-                sample = doLog(sample);
-                break;
-                
-            case static_cast<int>(ButtonName::sqrt):
-                sample = doSqrt(sample);
-                break;
-                
-            case static_cast<int>(ButtonName::cube):
-                sample = doCube(sample);
-                break;
-               
-            case static_cast<int>(ButtonName::fold):
-                sample = doFold(sample);
-                break;
-                
-            case static_cast<int>(ButtonName::squaredSine):
-                sample = doSquaredSine(sample);
-                break;
-
-            case static_cast<int>(ButtonName::asymmetricExp):
-                sample = doAsym(sample);
-                break;
-        }
-        
-        y += sample * oGain / 2.5f * scopeHeight;
-        
-        if (y < scopeT) y = scopeT;
-        if (y > scopeB) y = scopeB;
-        
-        if (i == 0) {
-            path.startNewSubPath(scopeL, y);
-            path2.startNewSubPath(scopeL, scopeT + (scopeB - scopeT) / 2);
-            
-            continue;
+
+// The assets render a picture per size, nothing to throw away here
+void GUI::resized() {}
+
+
+void GUI::timerCallback() {
+   #if PROFILING_MODE
+    if (++profileTicks == 15) {
+        profileTicks = 0;
+        const ProfileReport report = audioProcessor.getProfiler().collect(profileCursor);
+        if (report.blocks > 0) {
+            profileText = report.toString();
+            repaint(profileBounds);
         }
- 
-        path.lineTo(scopeL + (i * grainWidth), y);
-        path2.lineTo(scopeL + (i * grainWidth), scopeT + (scopeB - scopeT) / 2);
-    }
-    
-    g.strokePath(path, juce::PathStrokeType(4.0f));
-    g.strokePath(path2, juce::PathStrokeType(2.0f));
-    
-    
-    switch (selection) {
-        case static_cast<int>(ButtonName::tanh):
-            g.drawImageWithin(tanhImage,
-                              mathL,
-                              mathT,
-                              mathR - mathL,
-                              mathB - mathT,
-                              juce::RectanglePlacement::xMid);
-            break;
-            
-        case static_cast<int>(ButtonName::sine):
-            g.drawImageWithin(sineImage,
-                              mathL,
-                              mathT,
-                              mathR - mathL,
-                              mathB - mathT,
-                              juce::RectanglePlacement::xMid);
-            break;
-            
-        case static_cast<int>(ButtonName::hard):
-            g.drawImageWithin(hardImage,
-                              mathL,
-                              mathT,
-                              mathR - mathL,
-                              mathB - mathT,
-                              juce::RectanglePlacement::xMid);
-            break;
-            
-        case static_cast<int>(ButtonName::log):
-            g.drawImageWithin(logImage,
-                              mathL,
-                              mathT,
-                              mathR - mathL,
-                              mathB - mathT,
-                              juce::RectanglePlacement::xMid);
-            break;
-            
-        case static_cast<int>(ButtonName::sqrt):
-            g.drawImageWithin(sqrtImage,
-                              mathL,
-                              mathT,
-                              mathR - mathL,
-                              mathB - mathT,
-                              juce::RectanglePlacement::xMid);
-            break;
-            
-        case static_cast<int>(ButtonName::cube):
-            g.drawImageWithin(cubeImage,
-                              mathL,
-                              mathT,
-                              mathR - mathL,
-                              mathB - mathT,
-                              juce::RectanglePlacement::xMid);
-            break;
-           
-        case static_cast<int>(ButtonName::fold):
-            g.drawImageWithin(foldImage,
-                              mathL,
-                              mathT,
-                              mathR - mathL,
-                              mathB - mathT,
-                              juce::RectanglePlacement::xMid);
-            break;
-           
-        case static_cast<int>(ButtonName::squaredSine):
-            g.drawImageWithin(squaredSineImage,
-                              mathL,
-                              mathT,
-                              mathR - mathL,
-                              mathB - mathT,
-                              juce::RectanglePlacement::xMid);
-
-        case static_cast<int>(ButtonName::asymmetricExp):
-            // TODO add the image for x>0? harddist:hard(-x^8)
-            g.drawImageWithin(tanhImage,
-                              mathL,
-                              mathT,
-                              mathR - mathL,
-                              mathB - mathT,
-                              juce::RectanglePlacement::xMid);
-            break;
     }
+   #endif
+
+    juce::uint32 dirty = dirtyRegions.exchange(0);
+    if (drainMeter()) dirty |= scope;
+    if (dirty == 0) return;
+
+    if (dirty & inputText)     repaint(inputTextBounds);
+    if (dirty & outputText)    repaint(outputTextBounds);
+    if (dirty & selectionDots) repaint(selectionBounds);
+    if (dirty & equation)      repaint(equationBounds);
+    if (dirty & scope)         repaint(scopeBounds);
 }
 
 
-void GUI::resized() {}
+// Can come from the audio thread, only flags the areas for timerCallback
+void GUI::parameterChanged(const juce::String& parameterID, float newValue) {
+    newValue;
 
+    juce::uint32 regions = scope;
+    if (parameterID == getParameterInfo(ParameterNames::inGain).id)    regions |= inputText;
+    if (parameterID == getParameterInfo(ParameterNames::outGain).id)   regions |= outputText;
+    if (parameterID == getParameterInfo(ParameterNames::selection).id) regions |= selectionDots | equation;
 
-void GUI::timerCallback() {
-    // XXX for now this is required to react to automation changes but best practice would be to repaint only when a change is detected
-    repaint();
+    dirtyRegions.fetch_or(regions);
 }
 
 
@@ -309,6 +321,12 @@ void GUI::mouseDown (const juce::MouseEvent& event) {
     previousMouseY = event.position.y;
     
     currentButtonSelection = determineButton(event);
+
+    // Clicking the scope clears the clip counter
+    if (currentButtonSelection == ButtonName::none && scopeBounds.contains(event.x, event.y)) {
+        clipCount = 0;
+        repaint(scopeBounds);
+    }
     
     if (currentButtonSelection == ButtonName::none) return;
     if (currentButtonSelection == ButtonName::input) return;
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "EditorAssets.h"
 #include "PluginProcessor.h"
 
 constexpr int ioRow1 = 349, ioRow2 = 430, ioColumn = 101;
@@ -17,7 +18,7 @@ constexpr int scopeL = 37, scopeR = 189,
 constexpr int mathL = 230, mathR = 451,
         mathT = 20, mathB = 70;
 
-class GUI  : public juce::AudioProcessorEditor, private juce::Timer {
+class GUI  : public juce::AudioProcessorEditor, private juce::Timer, private juce::AudioProcessorValueTreeState::Listener {
   public:
     GUI (APSatur&);
     ~GUI() override;
@@ -25,6 +26,7 @@ class GUI  : public juce::AudioProcessorEditor, private juce::Timer {
     void paint (juce::Graphics&) override;
     void resized() override;
     void timerCallback() override;
+    void parameterChanged(const juce::String& parameterID, float newValue) override;
     void mouseDown (const juce::MouseEvent& event) override;
     void mouseDrag (const juce::MouseEvent& event) override;
     void mouseUp (const juce::MouseEvent& event) override;
@@ -32,17 +34,46 @@ class GUI  : public juce::AudioProcessorEditor, private juce::Timer {
     
   private:
     APSatur& audioProcessor;
-                
-    juce::Image backgroundImage;
-    
-    juce::Image tanhImage;
-    juce::Image hardImage;
-    juce::Image logImage;
-    juce::Image foldImage;
-    juce::Image squaredSineImage;
-    juce::Image sineImage;
-    juce::Image sqrtImage;
-    juce::Image cubeImage;
+
+    // Shared with every other open editor
+    juce::SharedResourcePointer<EditorAssets> assets;
+
+    // Transfer curve for the values it was built from, the zero line never changes
+    juce::Path curvePath;
+    juce::Path axisPath;
+    int curveSelection = -1;
+    float curveInputGain = 0, curveOutputGain = 0;
+
+    // Areas to repaint on the next timer tick, set from any thread by parameterChanged
+    enum DirtyRegion : juce::uint32 {
+        inputText     = 1 << 0,
+        outputText    = 1 << 1,
+        selectionDots = 1 << 2,
+        equation      = 1 << 3,
+        scope         = 1 << 4
+    };
+    std::atomic<juce::uint32> dirtyRegions { 0 };
+
+    // Live signal behind the transfer curve, one column per meter frame, the oldest at scopeWrite
+    static constexpr int scopeColumns = scopeR - scopeL;
+    std::array<MeterFrame, scopeColumns> scopeHistory;
+    size_t scopeWrite = 0;
+
+    // Decaying peaks, mean squares averaged over meterIntegrationSeconds, clips since the last click on the scope
+    float inputPeak = 0, outputPeak = 0;
+    float inputMeanSquare = 0, outputMeanSquare = 0;
+    int clipCount = 0;
+
+   #if PROFILING_MODE
+    // Latest stage timings, refreshed about twice a second
+    ProfileCursor profileCursor;
+    juce::String profileText;
+    int profileTicks = 0;
+   #endif
+
+    bool drainMeter();
+    void paintSignal(juce::Graphics& g);
+    void updateCurvePath(int selection, float inputGain, float outputGain);
 
     juce::Font customTypeface;
         
@@ -2,160 +2,755 @@
 #include <algorithm>
 #include <complex>
 #include <array>
+#include <type_traits>
 
 #include "APCommon.h"
 #include "PluginProcessor.h"
-#include "Saturation.h"
+#include "SaturationADAA.h"
+#include "SaturationTable.h"
 
 #ifndef M_PI
 #define M_PI 3.14159265358979323846
 #endif
 
+// Equal-power fade between two curves after a selection change
+static constexpr double curveCrossfadeSeconds = .02;
+
+// Highest oversampling choice, 16x
+static constexpr int maximumOversamplingStages = 4;
+
 
 APSatur::APSatur()
 : AudioProcessor(BusesProperties()
                  .withInput("Input", juce::AudioChannelSet::stereo(), true)
                  .withOutput("Output", juce::AudioChannelSet::stereo(), true)),
-apvts(*this, nullptr, "PARAMETERS", createParameterLayout()),
-inputGain(0),
-outputGain(0),
-parameterList(static_cast<int>(ParameterNames::END) + 1) {
+apvts(*this, nullptr, "PARAMETERS", createParameterLayout()) {
         
-    for (int i = 0; i < static_cast<int>(ParameterNames::END); ++i) {
+    for (const ParameterInfo& info : parameterRegistry) {
         
-        parameterList[i] = static_cast<juce::AudioParameterFloat*>(apvts.getParameter(queryParameter(static_cast<ParameterNames>(i)).id));
+        auto* parameter = apvts.getParameter(info.id);
+        const size_t index = static_cast<size_t>(info.name);
+
+        if (info.type == ParameterType::choice)
+            choiceParameters[index] = dynamic_cast<juce::AudioParameterChoice*>(parameter);
+        else
+            floatParameters[index] = dynamic_cast<juce::AudioParameterFloat*>(parameter);
     }
+
+    startTimerHz(20);
+
+   #if PROFILING_MODE
+    profileLog = std::make_unique<ProfileLog>(profiler);
+   #endif
 }
 
 
 void APSatur::prepareToPlay(double sampleRate, int samplesPerBlock) {
+    tables.build();
+    antiderivatives = &AntiderivativeTables::getInstance();
+    adaaState.assign(static_cast<size_t>(std::max(getTotalNumInputChannels(), 1)), ADAAChannelState());
+
+    // Playback starts at the knob values rather than ramping up from wherever the last run ended
+    inputRamp.prepare(sampleRate, samplesPerBlock);
+    outputRamp.prepare(sampleRate, samplesPerBlock);
+    inputRamp.reset(getInputGain());
+    outputRamp.reset(getOutputGain());
+    meter.prepare(sampleRate, samplesPerBlock);
+    silence.reset();
+    adaptive.prepare(sampleRate, adaaState.size(), samplesPerBlock);
+    maximumBlockSize = samplesPerBlock;
+    profiler.prepare(sampleRate);
+
+    if (isUsingDoublePrecision()) preparePrecisionState<double>(sampleRate, samplesPerBlock);
+    else preparePrecisionState<float>(sampleRate, samplesPerBlock);
+
+    crossfade.prepare(static_cast<size_t>(samplesPerBlock << maximumOversamplingStages));
+    crossfade.stop();
+    crossfadeAdaaState.assign(adaaState.size(), ADAAChannelState());
+    currentSelection = previousSelection = getChoiceIndex(ParameterNames::selection);
+
+    const ParameterSnapshot parameters = getParameterSnapshot();
+    bandAdaaState.assign(adaaState.size() * numBands, ADAAChannelState());
+    for (size_t band = 0; band < numBands; band++) {
+        bandDrives[band].prepare(sampleRate, samplesPerBlock);
+        bandOutputs[band].prepare(sampleRate, samplesPerBlock);
+        bandDrives[band].reset(parameters.bands[band].drive);
+        bandOutputs[band].reset(parameters.bands[band].output);
+    }
+    multibandActive = parameters.multiband;
+
+    models.prepare(sampleRate, adaaState.size(), maximumOversamplingStages);
+    currentModel = parameters.model;
+
+    peakCeiling.prepare(sampleRate, adaaState.size(), samplesPerBlock);
+    truePeakActive = parameters.truePeak;
+
+    swapFade.prepare(sampleRate);
     startOversampler(sampleRate, samplesPerBlock);
 }
 
 
+template <typename Sample>
+void APSatur::preparePrecisionState(double sampleRate, int samplesPerBlock) {
+    PrecisionState<Sample>& state = getPrecisionState<Sample>();
+    const int channels = static_cast<int>(adaaState.size());
+
+    state.dcBlocker.prepare(sampleRate, adaaState.size());
+    state.dcBlocker.reset();
+    state.linearBuffer.setSize(channels, samplesPerBlock);
+    state.crossfadeBuffer.setSize(channels, samplesPerBlock << maximumOversamplingStages);
+
+    state.splitter.prepare(sampleRate, adaaState.size(), samplesPerBlock);
+    state.splitter.setCrossovers(getFloatKnobValue(ParameterNames::lowCrossover), getFloatKnobValue(ParameterNames::highCrossover));
+    state.splitter.reset();
+    state.bandBuffer.setSize(channels * numBands, samplesPerBlock);
+}
+
+
 float APSatur::getFloatKnobValue(ParameterNames parameter) const {
-    return parameterList[static_cast<int>(parameter)]->get();
+    jassert(getParameterInfo(parameter).type == ParameterType::floating);
+    return floatParameters[static_cast<size_t>(parameter)]->get();
 }
 
 
-void APSatur::processBlock (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages) {
-    midiMessages;
+int APSatur::getChoiceIndex(ParameterNames parameter) const {
+    jassert(getParameterInfo(parameter).type == ParameterType::choice);
+    return choiceParameters[static_cast<size_t>(parameter)]->getIndex();
+}
+
+
+ParameterValues APSatur::getParameterValues() const {
+    ParameterValues values {};
+    for (size_t i = 0; i < numParameters; i++)
+        values[i] = floatParameters[i] != nullptr ? floatParameters[i]->get() : static_cast<float>(choiceParameters[i]->getIndex());
+    return values;
+}
+
+
+// Message thread, the values have to be within range
+void APSatur::applyParameterValues(int slot) {
+    const ParameterValues values = slots.load(slot);
+
+    slots.beginRecall(slot);
+    for (const ParameterInfo& info : parameterRegistry)
+        if (auto* parameter = apvts.getParameter(info.id))
+            parameter->setValueNotifyingHost(parameter->convertTo0to1(values[static_cast<size_t>(info.name)]));
+    slots.endRecall();
+}
+
+
+void APSatur::storeSlot(int slot) {
+    if (slot >= 0 && slot < StateSlots::numSlots) slots.store(slot, getParameterValues());
+}
+
+
+void APSatur::recallSlot(int slot) {
+    if (slot >= 0 && slot < StateSlots::numSlots && slots.isStored(slot)) applyParameterValues(slot);
+}
+
+
+bool APSatur::isSlotStored(int slot) const {
+    return slot >= 0 && slot < StateSlots::numSlots && slots.isStored(slot);
+}
+
+
+// All parameters at once, from the recalled slot when a recall or state load runs meanwhile
+ParameterSnapshot APSatur::getParameterSnapshot() const {
+    ParameterValues values;
+    slots.read(values, [this] (ParameterValues& destination) { destination = getParameterValues(); });
+
+    auto value = [&values] (ParameterNames name) { return values[static_cast<size_t>(name)]; };
+    auto index = [&values] (ParameterNames name) { return juce::roundToInt(values[static_cast<size_t>(name)]); };
+
+    ParameterSnapshot snapshot;
+    snapshot.inputGain = decibelsToGain(value(ParameterNames::inGain));
+    snapshot.outputGain = decibelsToGain(value(ParameterNames::outGain));
+    snapshot.selection = index(ParameterNames::selection);
+    snapshot.shaper = static_cast<ShaperEngine>(index(ParameterNames::shaper));
+    snapshot.adaa = static_cast<ADAAOrder>(index(ParameterNames::adaa));
+    snapshot.smoothingSeconds = value(ParameterNames::smoothing) / 1000.0;
+    snapshot.dcCutoff = dcFilterCutoffs[index(ParameterNames::dcFilter)];
+    snapshot.adaptiveOversampling = index(ParameterNames::adaptive) != 0;
+
+    snapshot.multiband = index(ParameterNames::multiband) != 0;
+    snapshot.lowCrossover = value(ParameterNames::lowCrossover);
+    snapshot.highCrossover = value(ParameterNames::highCrossover);
+    for (int band = 0; band < numBands; band++) {
+        ParameterSnapshot::Band& settings = snapshot.bands[static_cast<size_t>(band)];
+        settings.selection = index(bandParameter(ParameterNames::lowCurve, band));
+        settings.drive = decibelsToGain(value(bandParameter(ParameterNames::lowDrive, band)));
+        settings.output = decibelsToGain(value(bandParameter(ParameterNames::lowOutput, band)));
+    }
+
+    snapshot.model = static_cast<AnalogModel>(index(ParameterNames::model));
+    // The tape model holds its remanence as DC, which a playback head doesn't reproduce
+    if (snapshot.model == AnalogModel::tapeHysteresis && !snapshot.multiband)
+        snapshot.dcCutoff = std::max(snapshot.dcCutoff, TapeHysteresis::playbackCutoff);
+
+    snapshot.truePeak = index(ParameterNames::truePeak) != 0;
+    snapshot.ceiling = decibelsToGain(value(ParameterNames::ceiling));
+    return snapshot;
+}
+
+
+/**
+ * Oversampler latency plus the ADAA group delay, half a sample for first order
+ * and one for second order, both counted at the oversampled rate.
+ */
+static int totalLatency(const OversamplerEngine& engine, ADAAOrder adaa) {
+    const float factor = static_cast<float>(engine.getFactor());
+    float latency = engine.getLatency();
+
+    if (adaa == ADAAOrder::first) latency += .5f / factor;
+    if (adaa == ADAAOrder::second) latency += 1.0f / factor;
+
+    return juce::roundToInt(latency);
+}
+
+
+/**
+ * How long the output keeps going once the input stops : the latency, the oversampling
+ * filters ringing out, ADAA's couple of samples, the DC blocker falling by 120 dB and,
+ * given the low crossover in multiband mode, the crossover's slowest poles doing the same.
+ */
+static int totalTail(const OversamplerEngine& engine, int latency, float dcCutoff, float crossover, double sampleRate) {
+    int tail = latency + engine.getTailSamples() + 2;
+    if (dcCutoff > 0)
+        tail += static_cast<int>(std::ceil(std::log(1e6) / (juce::MathConstants<double>::twoPi * dcCutoff) * sampleRate));
+    // Butterworth poles decay at cos(pi / 4) times the cutoff
+    if (crossover > 0)
+        tail += static_cast<int>(std::ceil(std::log(1e6) / (juce::MathConstants<double>::twoPi * crossover * .7071) * sampleRate));
+    return tail;
+}
+
+
+int APSatur::getOversamplingStages() const {
+    return getChoiceIndex(ParameterNames::oversampling);
+}
+
+
+/**
+ * Multiband always runs on the low latency engine : it packs the bands into its SIMD
+ * lanes, JUCE's engines filter them one channel at a time. The crossovers already
+ * bend the phase, the FIR engine's linear phase would buy nothing there.
+ */
+OversamplerHandoff::FilterType APSatur::getOversamplingFilter() const {
+    if (getChoiceIndex(ParameterNames::multiband) != 0) return OversamplingFilter::iirLowLatency;
+    return static_cast<OversamplingFilter>(getChoiceIndex(ParameterNames::filter));
+}
+
+
+// One curve through one engine, specialized so the curve inlines into the sample loop
+template <typename Sample>
+using CurveKernel = void (*)(Sample* samples, size_t len, const SaturationTables& tables,
+                             const AntiderivativeTables& antiderivatives, ADAAChannelState& state);
+
+
+/**
+ * The SIMD and table engines are fitted to float, double blocks always go through
+ * the reference curve at their own precision.
+ */
+template <typename Sample, typename Curve>
+static CurveKernel<Sample> selectKernel(ShaperEngine engine, ADAAOrder adaa) {
+    // ADAA evaluates its own antiderivatives, the shaper engine only applies without it
+    if (adaa == ADAAOrder::first)
+        return [] (Sample* samples, size_t len, const SaturationTables&, const AntiderivativeTables& antiderivatives, ADAAChannelState& state) {
+            performSaturationADAA1<Curve::function>(antiderivatives, state, samples, len);
+        };
+
+    if (adaa == ADAAOrder::second)
+        return [] (Sample* samples, size_t len, const SaturationTables&, const AntiderivativeTables& antiderivatives, ADAAChannelState& state) {
+            performSaturationADAA2<Curve::function>(antiderivatives, state, samples, len);
+        };
+
+    if constexpr (!std::is_same_v<Sample, float>) {
+        return [] (Sample* samples, size_t len, const SaturationTables&, const AntiderivativeTables&, ADAAChannelState&) {
+            performSaturation<Curve::doubleFunction>(samples, len);
+        };
+    } else {
+        switch (engine) {
+            case ShaperEngine::linearTable:
+                return [] (float* samples, size_t len, const SaturationTables& tables, const AntiderivativeTables&, ADAAChannelState&) {
+                    performSaturationTable<Curve::function, TableInterpolation::linear>(tables, samples, len);
+                };
+
+            case ShaperEngine::cubicTable:
+                return [] (float* samples, size_t len, const SaturationTables& tables, const AntiderivativeTables&, ADAAChannelState&) {
+                    performSaturationTable<Curve::function, TableInterpolation::cubic>(tables, samples, len);
+                };
+
+            default:
+                return [] (float* samples, size_t len, const SaturationTables&, const AntiderivativeTables&, ADAAChannelState&) {
+                    performSaturationSIMD<Curve::function>(samples, len);
+                };
+        }
+    }
+}
+
+
+// Resolved once per block, nullptr for a selection that isn't a curve
+template <typename Sample>
+static CurveKernel<Sample> resolveKernel(int selection, ShaperEngine engine, ADAAOrder adaa) {
+    CurveKernel<Sample> kernel = nullptr;
+    visitCurve(selection, [&] (auto curve) { kernel = selectKernel<Sample, decltype(curve)>(engine, adaa); });
+    return kernel;
+}
+
+
+/**
+ * Runs at the host's precision from end to end : the engine's filters, the DC blocker
+ * and crossovers were built for it in prepareToPlay. Double blocks take the reference
+ * curves, see selectKernel, and the analog models compute in float either way.
+ */
+template <typename Sample>
+void APSatur::process(juce::AudioBuffer<Sample>& buffer) {
     juce::ScopedNoDenormals noDenormals;
+    profiler.beginBlock();
+
+    // Hosts only change precision before prepareToPlay
+    jassert(isUsingDoublePrecision() == (std::is_same_v<Sample, double>));
+    PrecisionState<Sample>& state = getPrecisionState<Sample>();
+
+    const ParameterSnapshot parameters = getParameterSnapshot();
 
     const int inputs = getTotalNumInputChannels();
     const int outputs = getTotalNumOutputChannels();
 
-    const float inputGainValueKnob  = decibelsToGain(getFloatKnobValue(ParameterNames::inGain));
-    const float outputGainValueKnob = decibelsToGain(getFloatKnobValue(ParameterNames::outGain));
+    // Outputs without a matching input would otherwise carry garbage
+    for (int channel = inputs; channel < outputs; channel++)
+        buffer.clear(channel, 0, buffer.getNumSamples());
 
-    juce::dsp::AudioBlock<float> originalBlock(buffer);
-    juce::dsp::AudioBlock<float> mainBlock;
-    
-    if (inputs < 1) return;
-    
-    if (inputs == 1) mainBlock = originalBlock.getSingleChannelBlock(0);
-    
-    if (inputs > 1) mainBlock = originalBlock.getSubsetChannelBlock(0, 2);
+    // Everything below was sized for adaaState.size() channels in prepareToPlay
+    const int channels = std::min(inputs, static_cast<int>(adaaState.size()));
+    if (channels < 1) return;
+
+    juce::dsp::AudioBlock<Sample> originalBlock(buffer);
+    juce::dsp::AudioBlock<Sample> mainBlock = originalBlock.getSubsetChannelBlock(0, static_cast<size_t>(channels));
     
-    std::shared_ptr<juce::dsp::Oversampling<float>> os(oversampler);
-    if(!os) return;
+    // A new engine only takes over once the output has faded out
+    swapFade.setDown(oversamplers.isSwapPending());
+    bool engineChanged;
+    OversamplerEngine* engine = oversamplers.acquire(engineChanged, swapFade.isDown());
+    if (antiderivatives == nullptr || engine == nullptr) return;
+
+    // Engines arrive freshly reset, only the ADAA history belongs to the old rate
+    if (engineChanged) {
+        std::fill(adaaState.begin(), adaaState.end(), ADAAChannelState());
+        std::fill(crossfadeAdaaState.begin(), crossfadeAdaaState.end(), ADAAChannelState());
+        std::fill(bandAdaaState.begin(), bandAdaaState.end(), ADAAChannelState());
+        models.reset();
+    }
+
+    const ADAAOrder adaa = parameters.adaa;
+
+    // The base rate path lines up with the oversampler alone, the ceiling comes after both
+    const int latency = totalLatency(*engine, adaa);
+    const int reportedLatency = latency + (parameters.truePeak ? peakCeiling.getLookahead() : 0);
+    if (latencySamples.exchange(reportedLatency) != reportedLatency) triggerAsyncUpdate();
+    if (engineChanged) swapFade.swapped(reportedLatency);
+
+    inputRamp.setRampTime(parameters.smoothingSeconds);
+    outputRamp.setRampTime(parameters.smoothingSeconds);
+    inputRamp.setTarget(parameters.inputGain);
+    outputRamp.setTarget(parameters.outputGain);
+    // Bounds what takes the ceiling's peaks to the output this block : the decimation's overshoot and the output gains
+    const float outputGainBound = engine->peakGain * outputRamp.getMaximumGain();
+    state.dcBlocker.setCutoff(parameters.dcCutoff);
+    state.splitter.setCrossovers(parameters.lowCrossover, parameters.highCrossover);
+    for (size_t band = 0; band < numBands; band++) {
+        bandDrives[band].setRampTime(parameters.smoothingSeconds);
+        bandOutputs[band].setRampTime(parameters.smoothingSeconds);
+        bandDrives[band].setTarget(parameters.bands[band].drive);
+        bandOutputs[band].setTarget(parameters.bands[band].output);
+    }
+
+    Sample* const* channelPointers = buffer.getArrayOfWritePointers();
+    const size_t n = mainBlock.getNumSamples();
+    const size_t factor = engine->getFactor();
+
+    const int tail = totalTail(*engine, reportedLatency, parameters.dcCutoff,
+                               parameters.multiband ? parameters.lowCrossover : 0.0f, getSampleRate());
+    tailSamples = tail;
+
+    // Silent for longer than anything rings, the block stays silent and nothing needs to run
+    const float inputPeak = SilenceDetector::findPeak(channelPointers, static_cast<size_t>(channels), n);
+    if (silence.update(boundOutput(inputPeak, parameters), n, tail)) {
+        // Everything rang out for its tail since the output last went over the floor,
+        // clearing it resumes from close to where silence would
+        if (silence.justEntered()) {
+            engine->reset();
+            std::fill(adaaState.begin(), adaaState.end(), ADAAChannelState());
+            std::fill(bandAdaaState.begin(), bandAdaaState.end(), ADAAChannelState());
+            state.dcBlocker.reset();
+            state.splitter.reset();
+            models.reset();
+            peakCeiling.reset();
+        }
+
+        // Nothing to fade, gain and curve changes land at once
+        inputRamp.reset(parameters.inputGain);
+        outputRamp.reset(parameters.outputGain);
+        for (size_t band = 0; band < numBands; band++) {
+            bandDrives[band].reset(parameters.bands[band].drive);
+            bandOutputs[band].reset(parameters.bands[band].output);
+        }
+        crossfade.stop();
+        currentSelection = previousSelection = parameters.selection;
+        swapFade.skip();
+
+        mainBlock.clear();
+        meter.measureSilence(static_cast<size_t>(channels), n);
+        profiler.endBlock(static_cast<int>(n));
+        return;
+    }
+
+    const int selection = parameters.selection;
+    const ShaperEngine shaper = parameters.shaper;
 
     /**
-     * Solve : inputGain * x^samples = newInputGain
-     * x = (inputGain/newInputGain)^(1/samples)
+     * The bands share the oversampler's first channels with the single band path,
+     * switching starts both from a clear history. The switch itself is a hard cut.
      */
-    size_t n = mainBlock.getNumSamples();
-    if(inputGain == inputGainValueKnob) {
-        mainBlock.multiplyBy(inputGain);
-    } else {
-        float iStep = std::pow(inputGain / inputGainValueKnob, 1.f / n);
-        for (int channel = 0; channel < 2 && channel < inputs; channel++) {
-            float gain = inputGain;
-            float* ptr = mainBlock.getChannelPointer(channel);
-            for(size_t i = 0; i < n; i++) {
-                ptr[i] *= gain;
-                gain *= iStep;
-            }
+    if (parameters.multiband != multibandActive) {
+        multibandActive = parameters.multiband;
+        engine->reset();
+        std::fill(adaaState.begin(), adaaState.end(), ADAAChannelState());
+        std::fill(bandAdaaState.begin(), bandAdaaState.end(), ADAAChannelState());
+        state.splitter.reset();
+        adaptive.reset();
+        crossfade.stop();
+        currentSelection = previousSelection = selection;
+    }
+
+    // Models start from rest, switching between them or to a curve is a hard cut
+    if (parameters.model != currentModel) {
+        currentModel = parameters.model;
+        models.reset();
+        std::fill(adaaState.begin(), adaaState.end(), ADAAChannelState());
+    }
+    const AnalogModel model = multibandActive ? AnalogModel::off : currentModel;
+    models.setOversamplingFactor(factor);
+
+    // Turning it on starts from an empty delay line, the switch is a hard cut like the latency change
+    if (parameters.truePeak != truePeakActive) {
+        truePeakActive = parameters.truePeak;
+        peakCeiling.reset();
+    }
+    float* const peaks = truePeakActive ? peakCeiling.beginBlock(n) : nullptr;
+    // The decimator's share of the oversampler latency, rounded up to stay on the safe side
+    const int detectionDelay = static_cast<int>(std::ceil(engine->getLatency()));
+
+    /**
+     * Adaptive oversampling looks at the driven input, bounded by the larger end of the
+     * gain ramp. A pending or running curve change keeps the oversampler on, the two
+     * curves needn't have the same slope. Only the FIR engine is linear phase with an
+     * integer delay, the base rate path lines up with nothing else.
+     */
+    const bool adaptiveEnabled = parameters.adaptiveOversampling && factor > 1 && !multibandActive
+                              && engine->getFilters<Sample>().oversampler != nullptr && engine->filter == OversamplingFilter::firEquiripple;
+    float peak = 0;
+    if (adaptiveEnabled) {
+        for (int channel = 0; channel < channels; channel++) {
+            const auto range = juce::FloatVectorOperations::findMinAndMax(channelPointers[channel], static_cast<int>(n));
+            peak = std::max({ peak, static_cast<float>(-range.getStart()), static_cast<float>(range.getEnd()) });
         }
-        inputGain = inputGainValueKnob;
+        peak *= inputRamp.getMaximumGain();
     }
 
-    juce::dsp::AudioBlock<float> oversampledBlock = os->processSamplesUp(mainBlock);
-    
-    const int selection = static_cast<int>(getFloatKnobValue(ParameterNames::selection));
-  
-    float* channelData[2];
-    
-    for (int i = 0; i < inputs && i < 2; i++) channelData[i] = oversampledBlock.getChannelPointer(i);
-    
-    size_t samples = oversampledBlock.getNumSamples();
+    const bool curveChanging = selection != currentSelection || crossfade.isActive();
+    // A model's output depends on more than the current sample, it never counts as linear
+    const float threshold = curveChanging || model != AnalogModel::off ? 0.0f : adaptive.getThreshold(currentSelection);
+    // Multiband runs the band curves, which have no threshold, oversampled all the time
+    const AdaptiveOversampling::Plan plan = multibandActive ? AdaptiveOversampling::Plan()
+                                                            : adaptive.update(adaptiveEnabled, peak, threshold, latency, n);
 
-    for (int channel = 0; channel < 2 && channel < inputs; channel++) {
-        switch (selection) {
-            case static_cast<int>(ButtonName::tanh):
-                performSaturation<doTanhStandard>(channelData[channel], samples);
-                break;
+    /**
+     * The filters were left alone during the linear stretch, they'd replay what they held then.
+     * Running the input that led up to the block through them and the curve, and throwing the
+     * output away, brings them to where the oversampled path would be had it kept running.
+     */
+    if (plan.reset) {
+        engine->reset();
+        std::fill(adaaState.begin(), adaaState.end(), ADAAChannelState());
 
-            case static_cast<int>(ButtonName::sine):
-                performSaturation<doSine>(channelData[channel], samples);
-                break;
+        const CurveKernel<Sample> primingKernel = resolveKernel<Sample>(currentSelection, shaper, adaa);
+        Sample* const* priming = state.linearBuffer.getArrayOfWritePointers();
+        const size_t primingLength = adaptive.getPrimingLength(engine->getTailSamples());
+        for (size_t done = 0; done < primingLength;) {
+            const size_t count = std::min(primingLength - done, static_cast<size_t>(maximumBlockSize));
+            adaptive.readDelayed(priming, static_cast<size_t>(channels), count, static_cast<int>(primingLength - done - count));
 
-            case static_cast<int>(ButtonName::hard):
-                performSaturation<doHard>(channelData[channel], samples);
-                break;
+            juce::dsp::AudioBlock<Sample> primingBlock(priming, static_cast<size_t>(channels), count);
+            juce::dsp::AudioBlock<Sample> oversampledBlock = engine->processSamplesUp(primingBlock);
+            for (size_t channel = 0; primingKernel != nullptr && channel < static_cast<size_t>(channels); channel++)
+                primingKernel(oversampledBlock.getChannelPointer(channel), oversampledBlock.getNumSamples(),
+                              tables, *antiderivatives, adaaState[channel]);
+            engine->processSamplesDown(primingBlock);
 
-            case static_cast<int>(ButtonName::log):
-                performSaturation<doLog>(channelData[channel], samples);
-                break;
+            done += count;
+        }
+    }
+
+    // A new curve fades in over the old one, a change during a fade waits for it to end
+    if (selection != currentSelection && !crossfade.isActive() && !plan.linear && !multibandActive) {
+        previousSelection = currentSelection;
+        currentSelection = selection;
+        std::copy(adaaState.begin(), adaaState.end(), crossfadeAdaaState.begin());
+        crossfade.start(juce::roundToInt(curveCrossfadeSeconds * getSampleRate() * static_cast<double>(factor)));
+    }
+
+    const bool fading = crossfade.isActive();
+    if (fading) crossfade.prepareBlock(n * factor);
+
+    const CurveKernel<Sample> kernel = resolveKernel<Sample>(currentSelection, shaper, adaa);
+    const CurveKernel<Sample> previousKernel = fading ? resolveKernel<Sample>(previousSelection, shaper, adaa) : nullptr;
+
+    // Shapes count oversampled samples of a channel starting offset samples into the block
+    auto shapeChannel = [&] (size_t channel, Sample* channelData, size_t offset, size_t count) {
+        if (model != AnalogModel::off) {
+            models.process(model, channel, channelData, count);
+        } else if (fading) {
+            Sample* previousData = state.crossfadeBuffer.getWritePointer(static_cast<int>(channel)) + offset;
+            std::copy(channelData, channelData + count, previousData);
+            if (previousKernel != nullptr) previousKernel(previousData, count, tables, *antiderivatives, crossfadeAdaaState[channel]);
+            if (kernel != nullptr) kernel(channelData, count, tables, *antiderivatives, adaaState[channel]);
+            crossfade.mix(channelData, previousData, offset, count);
+        } else if (kernel != nullptr) {
+            kernel(channelData, count, tables, *antiderivatives, adaaState[channel]);
+        }
+
+        if (peaks != nullptr) TruePeakCeiling::detect(peaks, channelData, offset, count, factor);
+    };
+
+    /**
+     * The low latency engine runs gains, filters and curve tile by tile out of L1,
+     * the others go stage by stage over whole blocks. So do the adaptive fades, which
+     * need the oversampled output on its own, and multiband.
+     */
+    PolyphaseIIROversampler<Sample>* const polyphase = engine->getFilters<Sample>().polyphase.get();
+    const bool fusable = polyphase != nullptr && !plan.linear && !multibandActive;
+    const float* inputGains = fusable ? inputRamp.nextGains(n) : nullptr;
+    const float* outputGains = inputGains != nullptr ? outputRamp.nextGains(n) : nullptr;
+
+    if (outputGains != nullptr) {
+        meter.measureInput(channelPointers, static_cast<size_t>(channels), n, inputGains);
+        if (adaptiveEnabled) adaptive.push(channelPointers, static_cast<size_t>(channels), n, inputGains);
+        profiler.mark(ProfileStage::inputGain);
+
+        polyphase->processFused(mainBlock, inputGains, outputGains,
+                                state.dcBlocker.isEnabled() ? &state.dcBlocker : nullptr, shapeChannel);
+        if (state.dcBlocker.isEnabled()) state.dcBlocker.flushDenormals();
+        if (fading) crossfade.advance(n * factor);
+        profiler.mark(ProfileStage::fused);
 
-            case static_cast<int>(ButtonName::sqrt):
-                performSaturation<doSqrt>(channelData[channel], samples);
-                break;
+        if (truePeakActive)
+            peakCeiling.process(channelPointers, static_cast<size_t>(channels), n, parameters.ceiling, outputGainBound, detectionDelay);
+        swapFade.process(channelPointers, static_cast<size_t>(channels), n);
+        meter.measureOutput(channelPointers, static_cast<size_t>(channels), n);
+        profiler.mark(ProfileStage::outputGain);
+        profiler.endBlock(static_cast<int>(n));
+        return;
+    }
+
+    inputRamp.process(channelPointers, static_cast<size_t>(channels), n);
+    meter.measureInput(channelPointers, static_cast<size_t>(channels), n);
+    // Fading back after the switch was turned off still reads the delayed input
+    if (adaptiveEnabled || plan.linear) adaptive.push(channelPointers, static_cast<size_t>(channels), n);
+    profiler.mark(ProfileStage::inputGain);
 
-            case static_cast<int>(ButtonName::cube):
-                performSaturation<doCube>(channelData[channel], samples);
-                break;
+    // Without ADAA, which only matters for aliasing, and at the base rate
+    Sample* const* linearPointers = state.linearBuffer.getArrayOfWritePointers();
+    if (plan.linear) {
+        adaptive.readDelayed(linearPointers, static_cast<size_t>(channels), n, latency);
 
-            case static_cast<int>(ButtonName::fold):
-                performSaturation<doFold>(channelData[channel], samples);
-                break;
+        if (const CurveKernel<Sample> linearKernel = resolveKernel<Sample>(currentSelection, shaper, ADAAOrder::off))
+            for (int channel = 0; channel < channels; channel++)
+                linearKernel(linearPointers[channel], n, tables, *antiderivatives, adaaState[static_cast<size_t>(channel)]);
+    }
+
+    if (multibandActive) {
+        processBands(mainBlock, *engine, parameters, peaks);
+        profiler.mark(ProfileStage::curve);
+    } else if (plan.oversampled) {
+        juce::dsp::AudioBlock<Sample> oversampledBlock = engine->processSamplesUp(mainBlock);
+        profiler.mark(ProfileStage::upsampling);
+
+        const size_t samples = oversampledBlock.getNumSamples();
+        for (size_t channel = 0; channel < static_cast<size_t>(channels); channel++)
+            shapeChannel(channel, oversampledBlock.getChannelPointer(channel), 0, samples);
+
+        if (fading) crossfade.advance(samples);
+        profiler.mark(ProfileStage::curve);
+
+        engine->processSamplesDown(mainBlock);
+    }
 
-            case static_cast<int>(ButtonName::squaredSine):
-                performSaturation<doSquaredSine>(channelData[channel], samples);
-                break;
+    for (int channel = 0; plan.linear && channel < channels; channel++) {
+        if (plan.oversampledWeights != nullptr)
+            AdaptiveOversampling::mix(channelPointers[channel], linearPointers[channel], plan.oversampledWeights, n);
+        else
+            std::copy(linearPointers[channel], linearPointers[channel] + n, channelPointers[channel]);
 
-            case static_cast<int>(ButtonName::asymmetricExp):
-                performSaturation<doAsym>(channelData[channel], samples);
-                break;
+        // Near linear, the base rate samples stand for the signal between them well enough
+        if (peaks != nullptr) TruePeakCeiling::detectSamples(peaks, channelPointers[channel], n);
+    }
+
+    if (state.dcBlocker.isEnabled()) state.dcBlocker.process(channelPointers, static_cast<size_t>(channels), n);
+    profiler.mark(ProfileStage::downsampling);
+
+    outputRamp.process(channelPointers, static_cast<size_t>(channels), n);
+    if (truePeakActive)
+        peakCeiling.process(channelPointers, static_cast<size_t>(channels), n, parameters.ceiling, outputGainBound, detectionDelay);
+    swapFade.process(channelPointers, static_cast<size_t>(channels), n);
+    meter.measureOutput(channelPointers, static_cast<size_t>(channels), n);
+    profiler.mark(ProfileStage::outputGain);
+    profiler.endBlock(static_cast<int>(n));
+}
+
+/**
+ * The driven peak through every curve the block can meet, the band gains included in
+ * multiband mode. Near 0 sqrt and cube are far steeper than 1 : -160 dBFS comes out of
+ * sqrt around -86 dBFS, the input alone says nothing. The models stay close to unity there.
+ */
+float APSatur::boundOutput(float peak, const ParameterSnapshot& parameters) const {
+    float driven = peak * inputRamp.getMaximumGain();
+    float gain = outputRamp.getMaximumGain();
+    if (parameters.multiband) {
+        float drive = 0, output = 0;
+        for (size_t band = 0; band < numBands; band++) {
+            drive = std::max(drive, bandDrives[band].getMaximumGain());
+            output = std::max(output, bandOutputs[band].getMaximumGain());
         }
+        driven *= drive;
+        // Each band is bounded on its own, their sum by all of them
+        gain *= output * numBands;
     }
 
-    os->processSamplesDown (mainBlock);
+    float level = driven;
+    auto through = [&level, driven] (int selection) {
+        if (!isCurve(selection)) return;
+        const auto curve = curveRegistry[selection].function;
+        level = std::max({ level, std::abs(curve(driven)), std::abs(curve(-driven)) });
+    };
 
-    // Same as input gain
-    if(outputGain == outputGainValueKnob) {
-        mainBlock.multiplyBy(outputGain);
+    if (parameters.multiband) {
+        for (const auto& band : parameters.bands) through(band.selection);
     } else {
-        float oStep = std::pow(outputGain / outputGainValueKnob, 1.f / n);
-        for (int channel = 0; channel < 2 && channel < inputs; channel++) {
-            float gain = outputGain;
-            float* ptr = mainBlock.getChannelPointer(channel);
-            for(size_t i = 0; i < n; i++) {
-                ptr[i] *= gain;
-                gain *= oStep;
-            }
+        through(parameters.selection);
+        through(currentSelection);
+        through(previousSelection);
+    }
+
+    return level * gain;
+}
+
+
+/**
+ * Drive, curve and output per band. Each band of each channel is a channel of its own
+ * for the oversampler, the polyphase engine multiband runs on packs them into its lanes
+ * so a stereo signal's six bands cost one SIMD group (two with 4 lanes) instead of three
+ * passes. Until the timer swaps engines after the switch, the old one filters them one by one.
+ */
+template <typename Sample>
+void APSatur::processBands(juce::dsp::AudioBlock<Sample>& block, OversamplerEngine& engine, const ParameterSnapshot& parameters,
+                           float* peaks) {
+    PrecisionState<Sample>& state = getPrecisionState<Sample>();
+    const size_t channels = block.getNumChannels();
+    const size_t n = block.getNumSamples();
+    Sample* const* bands = state.bandBuffer.getArrayOfWritePointers();
+
+    state.splitter.split(block, bands);
+
+    for (size_t band = 0; band < numBands; band++)
+        bandDrives[band].process(bands + band * channels, channels, n);
+
+    juce::dsp::AudioBlock<Sample> bandBlock(bands, channels * numBands, n);
+    juce::dsp::AudioBlock<Sample> oversampledBlock = engine.processSamplesUp(bandBlock);
+    const size_t samples = oversampledBlock.getNumSamples();
+
+    for (size_t band = 0; band < numBands; band++) {
+        const CurveKernel<Sample> kernel = resolveKernel<Sample>(parameters.bands[band].selection, parameters.shaper, parameters.adaa);
+        if (kernel == nullptr) continue;
+
+        for (size_t channel = band * channels; channel < (band + 1) * channels; channel++)
+            kernel(oversampledBlock.getChannelPointer(channel), samples, tables, *antiderivatives, bandAdaaState[channel]);
+    }
+
+    // The ceiling needs the bands' sum, the crossfade buffer is free in multiband mode
+    if (peaks != nullptr) {
+        for (size_t channel = 0; channel < channels; channel++) {
+            Sample* sum = state.crossfadeBuffer.getWritePointer(static_cast<int>(channel));
+            juce::FloatVectorOperations::copyWithMultiply(sum, oversampledBlock.getChannelPointer(channel),
+                                                          bandOutputs[0].getMaximumGain(), static_cast<int>(samples));
+            for (size_t band = 1; band < numBands; band++)
+                juce::FloatVectorOperations::addWithMultiply(sum, oversampledBlock.getChannelPointer(band * channels + channel),
+                                                             bandOutputs[band].getMaximumGain(), static_cast<int>(samples));
+            TruePeakCeiling::detect(peaks, sum, 0, samples, samples / n);
         }
-        outputGain = outputGainValueKnob;
     }
+
+    engine.processSamplesDown(bandBlock);
+
+    for (size_t band = 0; band < numBands; band++)
+        bandOutputs[band].process(bands + band * channels, channels, n);
+
+    BandSplitter<Sample>::join(bands, block);
+}
+
+
+/**
+ * Every buffer process uses, the oversamplers included, is sized for the block size
+ * prepareToPlay announced. Hosts aren't supposed to send more but some do, those
+ * blocks go through in pieces of that size.
+ */
+template <typename Sample>
+void APSatur::processInPieces(juce::AudioBuffer<Sample>& buffer) {
+    const int chunk = std::max(maximumBlockSize, 1);
+    if (buffer.getNumSamples() <= chunk) {
+        process(buffer);
+        return;
+    }
+
+    for (int start = 0; start < buffer.getNumSamples(); start += chunk) {
+        juce::AudioBuffer<Sample> piece(buffer.getArrayOfWritePointers(), buffer.getNumChannels(),
+                                        start, std::min(chunk, buffer.getNumSamples() - start));
+        process(piece);
+    }
+}
+
+
+void APSatur::processBlock (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages) {
+    midiMessages;
+    processInPieces(buffer);
+}
+
+
+void APSatur::processBlock (juce::AudioBuffer<double>& buffer, juce::MidiBuffer& midiMessages) {
+    midiMessages;
+    processInPieces(buffer);
 }
 
 void APSatur::startOversampler(double sampleRate, int samplesPerBlock) {
-    sampleRate;
-    
-    oversampler = std::make_shared<juce::dsp::Oversampling<float>>(2, 3, juce::dsp::Oversampling<float>::filterHalfBandFIREquiripple);
-    
-    oversampler->initProcessing(static_cast<size_t>(samplesPerBlock));
-    oversampler->reset();
-    
-    setLatencySamples(static_cast<int>(ceilf(oversampler->getLatencyInSamples())));
+    // Room for the bands, engines only run the channels a block brings
+    oversamplers.prepare(getOversamplingStages(), getOversamplingFilter(),
+                         adaaState.size() * numBands, static_cast<size_t>(samplesPerBlock), isUsingDoublePrecision());
+
+    bool engineChanged;
+    const OversamplerEngine& engine = *oversamplers.acquire(engineChanged);
+    const ADAAOrder adaa = static_cast<ADAAOrder>(getChoiceIndex(ParameterNames::adaa));
+    const ParameterSnapshot parameters = getParameterSnapshot();
+    latencySamples = totalLatency(engine, adaa) + (parameters.truePeak ? peakCeiling.getLookahead() : 0);
+    setLatencySamples(latencySamples);
+
+    tailSamples = totalTail(engine, latencySamples, parameters.dcCutoff,
+                            parameters.multiband ? parameters.lowCrossover : 0.0f, sampleRate);
+}
+
+void APSatur::timerCallback() {
+    oversamplers.request(getOversamplingStages(), getOversamplingFilter());
+    oversamplers.collectGarbage();
+}
+
+void APSatur::handleAsyncUpdate() {
+    setLatencySamples(latencySamples);
 }
@@ -1,8 +1,54 @@
 #pragma once
 
+#include <array>
+#include <type_traits>
 #include <vector>
 
-class APSatur  : public juce::AudioProcessor {
+#include "AdaptiveOversampling.h"
+#include "AnalogModels.h"
+#include "DCBlocker.h"
+#include "Metering.h"
+#include "Multiband.h"
+#include "OversamplerHandoff.h"
+#include "ParameterState.h"
+#include "Profiler.h"
+#include "SaturationADAA.h"
+#include "SaturationTable.h"
+#include "Silence.h"
+#include "Smoothing.h"
+#include "TruePeak.h"
+
+// Everything processBlock reads from the parameters, taken once at the start of the block
+struct ParameterSnapshot {
+    float inputGain;
+    float outputGain;
+    int selection;
+    ShaperEngine shaper;
+    ADAAOrder adaa;
+    double smoothingSeconds;
+    float dcCutoff;
+    bool adaptiveOversampling;
+
+    bool multiband;
+    float lowCrossover;
+    float highCrossover;
+
+    // Low, mid and high, drive and output as gains
+    struct Band {
+        int selection;
+        float drive;
+        float output;
+    };
+    std::array<Band, numBands> bands;
+
+    AnalogModel model;
+
+    bool truePeak;
+    // As a gain
+    float ceiling;
+};
+
+class APSatur  : public juce::AudioProcessor, private juce::AsyncUpdater, private juce::Timer {
     
 public:
     APSatur();
@@ -13,6 +59,8 @@ public:
     bool isBusesLayoutSupported (const BusesLayout& layouts) const override;
    #endif
     void processBlock (juce::AudioBuffer<float>&, juce::MidiBuffer&) override;
+    void processBlock (juce::AudioBuffer<double>&, juce::MidiBuffer&) override;
+    bool supportsDoublePrecisionProcessing() const override { return true; }
     juce::AudioProcessorEditor* createEditor() override;
     bool hasEditor() const override;
     const juce::String getName() const override;
@@ -29,25 +77,137 @@ public:
     void setStateInformation (const void* data, int sizeInBytes) override;
         
     float getFloatKnobValue(ParameterNames parameter) const;
+    int getChoiceIndex(ParameterNames parameter) const;
+    ParameterSnapshot getParameterSnapshot() const;
+    ParameterValues getParameterValues() const;
+
+    // A/B slots, message thread. Recalling an empty slot does nothing
+    void storeSlot(int slot);
+    void recallSlot(int slot);
+    bool isSlotStored(int slot) const;
 
     juce::AudioProcessorValueTreeState apvts;
     juce::AudioProcessorValueTreeState::ParameterLayout createParameterLayout();
 
     float getInputGain() const { return decibelsToGain(getFloatKnobValue(ParameterNames::inGain)); }
     float getOutputGain() const { return decibelsToGain(getFloatKnobValue(ParameterNames::outGain)); }
+
+    // Scope and meter frames, drained by the editor
+    SignalMeter& getMeter() { return meter; }
+
+   #if PROFILING_MODE
+    const BlockProfiler& getProfiler() const { return profiler; }
+   #endif
     
 private:
 
     float previousSample;
     
     void startOversampler(double sampleRate, int samplesPerBlock);
+
+    // Sets every parameter to the slot's values as one recall, see StateSlots
+    void applyParameterValues(int slot);
+    StateSlots slots;
+
+    // Both processBlocks, everything up to the curve kernels runs at the host's precision
+    template <typename Sample>
+    void process(juce::AudioBuffer<Sample>& buffer);
+    // Cuts a host block into pieces no longer than announced in prepareToPlay for process
+    template <typename Sample>
+    void processInPieces(juce::AudioBuffer<Sample>& buffer);
+    // Loudest a block peaking at peak can come out, for the silence detector
+    float boundOutput(float peak, const ParameterSnapshot& parameters) const;
+    // Split, oversampled curves per band and sum
+    template <typename Sample>
+    void processBands(juce::dsp::AudioBlock<Sample>& block, OversamplerEngine& engine, const ParameterSnapshot& parameters,
+                      float* peaks);
+    int getOversamplingStages() const;
+    OversamplerHandoff::FilterType getOversamplingFilter() const;
+
+    // Reports latencySamples to the host from the message thread
+    void handleAsyncUpdate() override;
+
+    // Builds the oversampler for changed settings and frees the one it replaced
+    void timerCallback() override;
     
-    float inputGain;
-    float outputGain;
+    SignalMeter meter;
+
+    BlockProfiler profiler;
+   #if PROFILING_MODE
+    std::unique_ptr<ProfileLog> profileLog;
+   #endif
+
+    GainRamp inputRamp;
+    GainRamp outputRamp;
+
+    // Filters and buffers holding samples, only the host's precision is prepared
+    template <typename Sample>
+    struct PrecisionState {
+        // After decimation, at the base rate
+        DCBlocker<Sample> dcBlocker;
+        // Base rate path of adaptive oversampling
+        juce::AudioBuffer<Sample> linearBuffer;
+        // Old curve's oversampled stream during a crossfade
+        juce::AudioBuffer<Sample> crossfadeBuffer;
+        // Every band of every channel is one more oversampler channel, band major
+        BandSplitter<Sample> splitter;
+        juce::AudioBuffer<Sample> bandBuffer;
+    };
+    PrecisionState<float> floatState;
+    PrecisionState<double> doubleState;
+
+    template <typename Sample>
+    PrecisionState<Sample>& getPrecisionState() {
+        if constexpr (std::is_same_v<Sample, float>) return floatState;
+        else return doubleState;
+    }
+
+    template <typename Sample>
+    void preparePrecisionState(double sampleRate, int samplesPerBlock);
+
+    // Base rate path taking over from the oversampler on near linear stretches, sized in prepareToPlay
+    AdaptiveOversampling adaptive;
+    int maximumBlockSize = 0;
+
+    // Old curve running next to the new one on the oversampled stream, sized in prepareToPlay
+    CurveCrossfade crossfade;
+    std::vector<ADAAChannelState> crossfadeAdaaState;
+    int currentSelection = 0;
+    int previousSelection = 0;
+
+    // Band curves' state, sized in prepareToPlay
+    std::vector<ADAAChannelState> bandAdaaState;
+    std::array<GainRamp, numBands> bandDrives;
+    std::array<GainRamp, numBands> bandOutputs;
+    bool multibandActive = false;
+
+    // Diode tables for every factor and per channel state, built in prepareToPlay
+    AnalogModels models;
+    AnalogModel currentModel = AnalogModel::off;
+
+    // Last stage, its lookahead counts towards the latency while it's on
+    TruePeakCeiling peakCeiling;
+    bool truePeakActive = false;
                 
-    std::shared_ptr<juce::dsp::Oversampling<float>> oversampler;
+    OversamplerHandoff oversamplers;
+    // Output fade around engine swaps
+    SwapFade swapFade;
+
+    std::atomic<int> latencySamples { 0 };
+    // Read by getTailLengthSeconds, updated every block
+    std::atomic<int> tailSamples { 0 };
+
+    SilenceDetector silence;
     
-    std::vector<juce::AudioParameterFloat*> parameterList;
+    SaturationTables tables;
+
+    const AntiderivativeTables* antiderivatives = nullptr;
+    // One per processed channel, sized in prepareToPlay
+    std::vector<ADAAChannelState> adaaState;
+
+    // Indexed by ParameterNames, only the array matching the parameter's type has it
+    std::array<juce::AudioParameterFloat*, static_cast<size_t>(ParameterNames::END)> floatParameters {};
+    std::array<juce::AudioParameterChoice*, static_cast<size_t>(ParameterNames::END)> choiceParameters {};
         
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (APSatur)
 };
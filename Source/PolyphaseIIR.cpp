@@ -0,0 +1,350 @@
+#include <algorithm>
+#include <cmath>
+
+#include "PolyphaseIIR.h"
+
+
+// Elliptic modulus k and nome q of a half-band with the given transition band
+static void computeTransitionParameters(double& k, double& q, double transition) {
+    k = std::tan((1 - transition * 2) * juce::MathConstants<double>::pi / 4);
+    k *= k;
+
+    const double kRoot = std::pow(1 - k * k, .25);
+    const double e = .5 * (1 - kRoot) / (1 + kRoot);
+    const double e4 = e * e * e * e;
+    q = e * (1 + e4 * (2 + e4 * (15 + 150 * e4)));
+}
+
+
+template <typename Sample>
+int PolyphaseIIROversampler<Sample>::computeOrder(double attenuation, double transition) {
+    double k, q;
+    computeTransitionParameters(k, q, transition);
+
+    const double power = std::pow(10.0, -attenuation / 10);
+    const double a = power / (1 - power);
+
+    int order = static_cast<int>(std::ceil(std::log(a * a / 16) / std::log(q)));
+    if (order % 2 == 0) order++;
+    if (order == 1) order = 3;
+
+    return (order - 1) / 2;
+}
+
+
+template <typename Sample>
+std::vector<Sample> PolyphaseIIROversampler<Sample>::computeCoefficients(int numCoefficients, double transition) {
+    constexpr double pi = juce::MathConstants<double>::pi;
+
+    double k, q;
+    computeTransitionParameters(k, q, transition);
+
+    const int order = numCoefficients * 2 + 1;
+    std::vector<Sample> coefficients(static_cast<size_t>(numCoefficients));
+
+    for (int index = 0; index < numCoefficients; index++) {
+        const int c = index + 1;
+
+        // Both theta series converge after a handful of terms, q < .1 here
+        double numerator = 0, term;
+        int sign = 1;
+        for (int i = 0; i == 0 || std::abs(term) > 1e-100; i++, sign = -sign) {
+            term = std::pow(q, i * (i + 1)) * std::sin((i * 2 + 1) * c * pi / order) * sign;
+            numerator += term;
+        }
+        numerator *= std::pow(q, .25);
+
+        double denominator = .5;
+        sign = -1;
+        for (int i = 1; i == 1 || std::abs(term) > 1e-100; i++, sign = -sign) {
+            term = std::pow(q, i * i) * std::cos(i * 2 * c * pi / order) * sign;
+            denominator += term;
+        }
+
+        const double w = numerator / denominator;
+        const double w2 = w * w;
+        const double x = std::sqrt((1 - w2 * k) * (1 - w2 / k)) / (1 + w2);
+        coefficients[static_cast<size_t>(index)] = static_cast<Sample>((1 - x) / (1 + x));
+    }
+
+    return coefficients;
+}
+
+
+template <typename Sample>
+PolyphaseIIROversampler<Sample>::PolyphaseIIROversampler(size_t numChannels, int numStages)
+: channels(numChannels),
+groups((numChannels + Lanes::width - 1) / Lanes::width) {
+
+    /**
+     * 96 dB below the images for audio up to .46 * fs.
+     * The first stage has to keep the full base band, later ones only have to stop
+     * what would fold back onto it, so their transition band widens quickly.
+     */
+    constexpr double attenuation = 96;
+    constexpr double passband = .46;
+
+    double ring = 0;
+
+    for (int s = 0; s < numStages; s++) {
+        const double transition = .5 - passband / (1 << s);
+
+        Stage stage;
+        stage.coefficients = computeCoefficients(computeOrder(attenuation, transition), transition);
+
+        /**
+         * A first order allpass (a + z^-1) / (1 + a z^-1) delays DC by (1 - a) / (1 + a).
+         * The even and odd chains of a half-band together delay the base band by the
+         * sum of both, counted at this stage's input rate.
+         */
+        double delay = 0;
+        for (Sample a : stage.coefficients) delay += (1.0 - a) / (1.0 + a);
+        latency += static_cast<float>(delay / (1 << s));
+
+        /**
+         * Each section rings like its pole at -a at the stage's lower rate, the largest
+         * a sets how long the stage takes to fall by 120 dB, up and down both ring.
+         * Doubled for the sections stacking up.
+         */
+        const Sample largest = *std::max_element(stage.coefficients.begin(), stage.coefficients.end());
+        ring += 4 * std::log(1e-6) / std::log(std::max(static_cast<double>(largest), 1e-3)) / (1 << s);
+
+        stages.push_back(std::move(stage));
+    }
+
+    tail = static_cast<int>(std::ceil(ring));
+
+    memory.resize(groups);
+    for (auto& group : memory) {
+        group.resize(stages.size());
+        for (size_t s = 0; s < stages.size(); s++) {
+            const size_t order = stages[s].coefficients.size();
+            group[s].upX.resize(order);
+            group[s].upY.resize(order);
+            group[s].downX.resize(order);
+            group[s].downY.resize(order);
+        }
+    }
+}
+
+
+template <typename Sample>
+void PolyphaseIIROversampler<Sample>::initProcessing(size_t maximumNumberOfSamplesBeforeOversampling) {
+    const size_t maximum = maximumNumberOfSamplesBeforeOversampling * getOversamplingFactor();
+
+    oversampledBuffer.setSize(static_cast<int>(channels), static_cast<int>(maximum), false, false, true);
+    work[0].resize(maximum);
+    work[1].resize(maximum);
+
+    // A tile holds at least one base rate sample
+    jassert(getOversamplingFactor() <= fusedTileLanes);
+    tileWork[0].resize(fusedTileLanes);
+    tileWork[1].resize(fusedTileLanes);
+    tileChannels.resize(Lanes::width * fusedTileLanes);
+
+    reset();
+}
+
+
+template <typename Sample>
+void PolyphaseIIROversampler<Sample>::reset() {
+    for (auto& group : memory) {
+        for (auto& state : group) {
+            std::fill(state.upX.begin(), state.upX.end(), Lanes(Sample(0)));
+            std::fill(state.upY.begin(), state.upY.end(), Lanes(Sample(0)));
+            std::fill(state.downX.begin(), state.downX.end(), Lanes(Sample(0)));
+            std::fill(state.downY.begin(), state.downY.end(), Lanes(Sample(0)));
+        }
+    }
+    oversampledBuffer.clear();
+}
+
+
+/**
+ * Even coefficients form the chain producing the even output samples, odd ones
+ * the odd samples. Each section is y[n] = a * (x[n] - y[n-1]) + x[n-1].
+ */
+template <typename Sample>
+void PolyphaseIIROversampler<Sample>::upsample(const Stage& stage, Memory& state, const Lanes* input, Lanes* output, size_t numSamples) {
+    const Sample* c = stage.coefficients.data();
+    const size_t order = stage.coefficients.size();
+
+    for (size_t n = 0; n < numSamples; n++) {
+        Lanes even = input[n];
+        Lanes odd = input[n];
+
+        size_t i = 0;
+        for (; i + 1 < order; i += 2) {
+            const Lanes e = (even - state.upY[i]) * c[i] + state.upX[i];
+            const Lanes o = (odd - state.upY[i + 1]) * c[i + 1] + state.upX[i + 1];
+            state.upX[i] = even;
+            state.upX[i + 1] = odd;
+            state.upY[i] = even = e;
+            state.upY[i + 1] = odd = o;
+        }
+        if (i < order) {
+            const Lanes e = (even - state.upY[i]) * c[i] + state.upX[i];
+            state.upX[i] = even;
+            state.upY[i] = even = e;
+        }
+
+        output[2 * n] = even;
+        output[2 * n + 1] = odd;
+    }
+}
+
+
+template <typename Sample>
+void PolyphaseIIROversampler<Sample>::downsample(const Stage& stage, Memory& state, const Lanes* input, Lanes* output, size_t numSamples) {
+    const Sample* c = stage.coefficients.data();
+    const size_t order = stage.coefficients.size();
+
+    for (size_t n = 0; n < numSamples; n++) {
+        Lanes even = input[2 * n + 1];
+        Lanes odd = input[2 * n];
+
+        size_t i = 0;
+        for (; i + 1 < order; i += 2) {
+            const Lanes e = (even - state.downY[i]) * c[i] + state.downX[i];
+            const Lanes o = (odd - state.downY[i + 1]) * c[i + 1] + state.downX[i + 1];
+            state.downX[i] = even;
+            state.downX[i + 1] = odd;
+            state.downY[i] = even = e;
+            state.downY[i + 1] = odd = o;
+        }
+        if (i < order) {
+            const Lanes e = (even - state.downY[i]) * c[i] + state.downX[i];
+            state.downX[i] = even;
+            state.downY[i] = even = e;
+        }
+
+        output[n] = (even + odd) * Sample(.5f);
+    }
+}
+
+
+template <typename Sample>
+juce::dsp::AudioBlock<Sample> PolyphaseIIROversampler<Sample>::processSamplesUp(const juce::dsp::AudioBlock<const Sample>& inputBlock) {
+    const size_t numSamples = inputBlock.getNumSamples();
+    const size_t numChannels = std::min(channels, inputBlock.getNumChannels());
+
+    for (size_t g = 0; g < groups && g * Lanes::width < numChannels; g++) {
+        Lanes* in = work[0].data();
+        Lanes* out = work[1].data();
+
+        // Transpose the group's channels into lanes, missing channels stay silent
+        for (size_t n = 0; n < numSamples; n++) in[n] = Lanes(Sample(0));
+        for (size_t lane = 0; lane < Lanes::width && g * Lanes::width + lane < numChannels; lane++) {
+            const Sample* source = inputBlock.getChannelPointer(g * Lanes::width + lane);
+            for (size_t n = 0; n < numSamples; n++) in[n][lane] = source[n];
+        }
+
+        size_t length = numSamples;
+        for (size_t s = 0; s < stages.size(); s++) {
+            upsample(stages[s], memory[g][s], in, out, length);
+            std::swap(in, out);
+            length *= 2;
+        }
+
+        for (size_t lane = 0; lane < Lanes::width && g * Lanes::width + lane < numChannels; lane++) {
+            Sample* destination = oversampledBuffer.getWritePointer(static_cast<int>(g * Lanes::width + lane));
+            for (size_t n = 0; n < length; n++) destination[n] = in[n][lane];
+        }
+    }
+
+    return juce::dsp::AudioBlock<Sample>(oversampledBuffer).getSubBlock(0, numSamples * getOversamplingFactor())
+                                                            .getSubsetChannelBlock(0, numChannels);
+}
+
+
+template <typename Sample>
+void PolyphaseIIROversampler<Sample>::processSamplesDown(juce::dsp::AudioBlock<Sample>& outputBlock) {
+    const size_t numSamples = outputBlock.getNumSamples();
+    const size_t numChannels = std::min(channels, outputBlock.getNumChannels());
+
+    for (size_t g = 0; g < groups && g * Lanes::width < numChannels; g++) {
+        Lanes* in = work[0].data();
+        Lanes* out = work[1].data();
+
+        size_t length = numSamples * getOversamplingFactor();
+        for (size_t n = 0; n < length; n++) in[n] = Lanes(Sample(0));
+        for (size_t lane = 0; lane < Lanes::width && g * Lanes::width + lane < numChannels; lane++) {
+            const Sample* source = oversampledBuffer.getReadPointer(static_cast<int>(g * Lanes::width + lane));
+            for (size_t n = 0; n < length; n++) in[n][lane] = source[n];
+        }
+
+        for (size_t s = stages.size(); s-- > 0;) {
+            length /= 2;
+            downsample(stages[s], memory[g][s], in, out, length);
+            std::swap(in, out);
+        }
+
+        for (size_t lane = 0; lane < Lanes::width && g * Lanes::width + lane < numChannels; lane++) {
+            Sample* destination = outputBlock.getChannelPointer(g * Lanes::width + lane);
+            for (size_t n = 0; n < numSamples; n++) destination[n] = in[n][lane];
+        }
+    }
+}
+
+
+template <typename Sample>
+Sample* PolyphaseIIROversampler<Sample>::upsampleTile(const juce::dsp::AudioBlock<Sample>& block, size_t numChannels, size_t group,
+                                                      size_t offset, size_t numSamples, const float* gains) {
+    Lanes* in = tileWork[0].data();
+    Lanes* out = tileWork[1].data();
+
+    for (size_t n = 0; n < numSamples; n++) in[n] = Lanes(Sample(0));
+    for (size_t lane = 0; lane < Lanes::width && group * Lanes::width + lane < numChannels; lane++) {
+        const Sample* source = block.getChannelPointer(group * Lanes::width + lane) + offset;
+        for (size_t n = 0; n < numSamples; n++) in[n][lane] = source[n] * gains[offset + n];
+    }
+
+    size_t length = numSamples;
+    for (size_t s = 0; s < stages.size(); s++) {
+        upsample(stages[s], memory[group][s], in, out, length);
+        std::swap(in, out);
+        length *= 2;
+    }
+
+    // The result sits in tileWork[stages % 2], downsampleTile picks it up there
+    for (size_t lane = 0; lane < Lanes::width && group * Lanes::width + lane < numChannels; lane++) {
+        Sample* destination = tileChannels.data() + lane * fusedTileLanes;
+        for (size_t n = 0; n < length; n++) destination[n] = in[n][lane];
+    }
+
+    return tileChannels.data();
+}
+
+
+template <typename Sample>
+void PolyphaseIIROversampler<Sample>::downsampleTile(juce::dsp::AudioBlock<Sample>& block, size_t numChannels, size_t group,
+                                                     size_t offset, size_t numSamples, const float* gains, DCBlocker<Sample>* dcBlocker) {
+    Lanes* in = tileWork[stages.size() % 2].data();
+    Lanes* out = tileWork[(stages.size() + 1) % 2].data();
+
+    // Lanes of missing channels keep their silent upsampled values
+    size_t length = numSamples * getOversamplingFactor();
+    for (size_t lane = 0; lane < Lanes::width && group * Lanes::width + lane < numChannels; lane++) {
+        const Sample* source = tileChannels.data() + lane * fusedTileLanes;
+        for (size_t n = 0; n < length; n++) in[n][lane] = source[n];
+    }
+
+    for (size_t s = stages.size(); s-- > 0;) {
+        length /= 2;
+        downsample(stages[s], memory[group][s], in, out, length);
+        std::swap(in, out);
+    }
+
+    // Still in lanes, the DC blocker runs all of the group's channels at once
+    if (dcBlocker != nullptr)
+        for (size_t n = 0; n < numSamples; n++) in[n] = dcBlocker->processSample(group, in[n]);
+
+    for (size_t lane = 0; lane < Lanes::width && group * Lanes::width + lane < numChannels; lane++) {
+        Sample* destination = block.getChannelPointer(group * Lanes::width + lane) + offset;
+        for (size_t n = 0; n < numSamples; n++) destination[n] = in[n][lane] * gains[offset + n];
+    }
+}
+
+
+template class PolyphaseIIROversampler<float>;
+template class PolyphaseIIROversampler<double>;
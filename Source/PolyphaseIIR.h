@@ -0,0 +1,130 @@
+#pragma once
+
+#include <algorithm>
+#include <vector>
+
+#include "APSIMD.h"
+#include "DCBlocker.h"
+
+/**
+ * Minimum latency 2^stages oversampler made of polyphase allpass IIR half-bands
+ * (Regalia/Mitra structure, coefficients from the elliptic design used by
+ * de Soras' HIIR). Each half-band is two chains of first order allpasses running
+ * at the lower rate, so a stage costs one multiply per coefficient per output pair.
+ *
+ * Unlike juce::dsp::Oversampling's IIR mode nothing pads the phase response to an
+ * integer delay : the reported latency is the group delay at DC, a few samples at
+ * the base rate for every factor.
+ *
+ * Channels are packed into the lanes of one SIMD register, 4 or 8 channels cost
+ * the same as one. Only the groups holding a channel of the block run, capacity
+ * prepared for channels a block doesn't bring costs nothing.
+ * Instantiated for float and double, a register holds half as many double lanes.
+ */
+template <typename Sample>
+class PolyphaseIIROversampler {
+public:
+    PolyphaseIIROversampler(size_t numChannels, int numStages);
+
+    void initProcessing(size_t maximumNumberOfSamplesBeforeOversampling);
+    void reset();
+
+    // Same contract as juce::dsp::Oversampling : the returned block is owned here
+    // and processed in place before processSamplesDown reads it back
+    juce::dsp::AudioBlock<Sample> processSamplesUp(const juce::dsp::AudioBlock<const Sample>& inputBlock);
+    void processSamplesDown(juce::dsp::AudioBlock<Sample>& outputBlock);
+
+    /**
+     * Whole round trip in one pass over the block, in place.
+     * The block is cut into tiles short enough that a tile's oversampled lanes stay in
+     * L1 : each tile is transposed into lanes with the input gains applied, upsampled
+     * through every stage, handed per channel to shape(channel, samples, offset, count)
+     * where offset counts oversampled samples from the block start, then decimated and
+     * written back through the DC blocker, when there is one, and the output gains.
+     * Nothing at the oversampled rate ever goes out to memory. Both gain arrays hold
+     * one gain per base rate sample.
+     */
+    template <typename Shaper>
+    void processFused(juce::dsp::AudioBlock<Sample>& block, const float* inputGains, const float* outputGains,
+                      DCBlocker<Sample>* dcBlocker, Shaper&& shape);
+
+    float getLatencyInSamples() const { return latency; }
+    // Base rate samples the filters keep ringing for once the input stops
+    int getTailSamples() const { return tail; }
+    size_t getOversamplingFactor() const { return static_cast<size_t>(1) << stages.size(); }
+
+    /**
+     * Number of allpass coefficients reaching the given stopband attenuation (dB)
+     * for a transition band normalized to the higher rate, and their values.
+     */
+    static int computeOrder(double attenuation, double transition);
+    static std::vector<Sample> computeCoefficients(int numCoefficients, double transition);
+
+private:
+    using Lanes = SIMDRegisterLanes<Sample>;
+
+    struct Stage {
+        std::vector<Sample> coefficients;
+    };
+
+    // Allpass input and output history, one set per direction
+    struct Memory {
+        std::vector<Lanes> upX, upY, downX, downY;
+    };
+
+    size_t channels;
+    size_t groups;
+    std::vector<Stage> stages;
+
+    // [group][stage]
+    std::vector<std::vector<Memory>> memory;
+
+    juce::AudioBuffer<Sample> oversampledBuffer;
+    std::vector<Lanes> work[2];
+
+    // Oversampled lanes per fused tile, two of these buffers take 8 kB with SSE and 16 kB with AVX
+    static constexpr size_t fusedTileLanes = 256;
+
+    std::vector<Lanes> tileWork[2];
+    // One tile of every lane laid out per channel, for the shaper
+    std::vector<Sample> tileChannels;
+
+    float latency = 0;
+    int tail = 0;
+
+    static void upsample(const Stage& stage, Memory& state, const Lanes* input, Lanes* output, size_t numSamples);
+    static void downsample(const Stage& stage, Memory& state, const Lanes* input, Lanes* output, size_t numSamples);
+
+    size_t getFusedTileLength() const { return std::max(fusedTileLanes / getOversamplingFactor(), static_cast<size_t>(1)); }
+
+    // Fused tile helpers, upsampleTile returns the group's oversampled tile laid out per channel
+    Sample* upsampleTile(const juce::dsp::AudioBlock<Sample>& block, size_t numChannels, size_t group,
+                         size_t offset, size_t numSamples, const float* gains);
+    void downsampleTile(juce::dsp::AudioBlock<Sample>& block, size_t numChannels, size_t group,
+                        size_t offset, size_t numSamples, const float* gains, DCBlocker<Sample>* dcBlocker);
+};
+
+
+template <typename Sample>
+template <typename Shaper>
+void PolyphaseIIROversampler<Sample>::processFused(juce::dsp::AudioBlock<Sample>& block, const float* inputGains,
+                                                   const float* outputGains, DCBlocker<Sample>* dcBlocker, Shaper&& shape) {
+    const size_t numSamples = block.getNumSamples();
+    const size_t numChannels = std::min(channels, block.getNumChannels());
+    const size_t factor = getOversamplingFactor();
+    const size_t tile = getFusedTileLength();
+
+    // Each group's filters only carry their own history, a group can run its whole block at once
+    for (size_t g = 0; g < groups && g * Lanes::width < numChannels; g++) {
+        for (size_t offset = 0; offset < numSamples; offset += tile) {
+            const size_t length = std::min(tile, numSamples - offset);
+            Sample* samples = upsampleTile(block, numChannels, g, offset, length, inputGains);
+
+            const size_t count = length * factor;
+            for (size_t lane = 0; lane < Lanes::width && g * Lanes::width + lane < numChannels; lane++)
+                shape(g * Lanes::width + lane, samples + lane * fusedTileLanes, offset * factor, count);
+
+            downsampleTile(block, numChannels, g, offset, length, outputGains, dcBlocker);
+        }
+    }
+}
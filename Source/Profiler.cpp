@@ -0,0 +1,129 @@
+#include "Profiler.h"
+
+#if PROFILING_MODE
+
+static const char* const stageNames[] = { "input", "up", "curve", "down", "output", "fused" };
+
+
+void BlockProfiler::prepare(double sampleRate) {
+   #if JUCE_INTEL
+    const juce::int64 ticks = juce::Time::getHighResolutionTicks();
+    const juce::uint64 counts = readCounter();
+    juce::Thread::sleep(20);
+    const double rate = static_cast<double>(readCounter() - counts)
+                      / juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - ticks);
+   #else
+    const double rate = static_cast<double>(juce::Time::getHighResolutionTicksPerSecond());
+   #endif
+
+    countsPerSecond = rate;
+    countsPerSample = rate / sampleRate;
+}
+
+
+/**
+ * Percentiles are read off the interval's histogram, taking the middle of the bin
+ * the rank falls in, and max is the upper edge of the highest bin used.
+ */
+static ProfileStatistics summarize(const LogHistogram& histogram, juce::uint32* previous, double scale) {
+    std::array<juce::uint32, LogHistogram::numBins> counts;
+    juce::uint64 total = 0;
+
+    for (int bin = 0; bin < LogHistogram::numBins; bin++) {
+        const juce::uint32 count = histogram.count(bin);
+        counts[static_cast<size_t>(bin)] = count - previous[bin];
+        previous[bin] = count;
+        total += counts[static_cast<size_t>(bin)];
+    }
+
+    ProfileStatistics statistics;
+    if (total == 0) return statistics;
+
+    const juce::uint64 rank50 = (total + 1) / 2, rank99 = std::max<juce::uint64>(1, (total * 99 + 99) / 100);
+    juce::uint64 seen = 0;
+
+    for (int bin = 0; bin < LogHistogram::numBins; bin++) {
+        const juce::uint32 count = counts[static_cast<size_t>(bin)];
+        if (count == 0) continue;
+
+        const double middle = (LogHistogram::lowerBound(bin) + LogHistogram::width(bin) / 2) * scale;
+        if (seen < rank50 && seen + count >= rank50) statistics.p50 = middle;
+        if (seen < rank99 && seen + count >= rank99) statistics.p99 = middle;
+        seen += count;
+
+        statistics.max = (LogHistogram::lowerBound(bin) + LogHistogram::width(bin)) * scale;
+    }
+
+    return statistics;
+}
+
+
+ProfileReport BlockProfiler::collect(ProfileCursor& cursor) const {
+    constexpr size_t numHistograms = static_cast<size_t>(ProfileStage::END) + 1;
+    cursor.resize(numHistograms * LogHistogram::numBins);
+
+    ProfileReport report;
+    const double microsecondsPerCount = 1e6 / countsPerSecond;
+
+    for (size_t stage = 0; stage < stages.size(); stage++)
+        report.stages[stage] = summarize(stages[stage], cursor.data() + stage * LogHistogram::numBins, microsecondsPerCount);
+
+    // Blocks are counted from the budget histogram, which gets one entry per finished block
+    juce::uint32* budgetCursor = cursor.data() + stages.size() * LogHistogram::numBins;
+    for (int bin = 0; bin < LogHistogram::numBins; bin++)
+        report.blocks += budget.count(bin) - budgetCursor[bin];
+
+    report.budget = summarize(budget, budgetCursor, 1e-6);
+    return report;
+}
+
+
+juce::String ProfileReport::toString() const {
+    juce::String text;
+    text << static_cast<int>(blocks) << " blocks, us p50/p99/max";
+
+    for (size_t stage = 0; stage < stages.size(); stage++)
+        text << "  " << stageNames[stage] << " " << juce::String(stages[stage].p50, 1) << "/"
+             << juce::String(stages[stage].p99, 1) << "/" << juce::String(stages[stage].max, 1);
+
+    text << "  budget " << juce::String(budget.p50 * 100, 1) << "/" << juce::String(budget.p99 * 100, 1)
+         << "/" << juce::String(budget.max * 100, 1) << " %";
+    return text;
+}
+
+
+ProfileLog::ProfileLog(const BlockProfiler& p)
+: juce::Thread("Saturation profile log"),
+profiler(p) {
+    static std::atomic<int> instances { 0 };
+
+    file = juce::FileLogger::getSystemLogFileFolder().getChildFile("Saturation")
+                                                      .getChildFile("profile-" + juce::String(++instances) + ".log");
+    file.getParentDirectory().createDirectory();
+
+    startThread();
+}
+
+
+ProfileLog::~ProfileLog() {
+    stopThread(2000);
+}
+
+
+void ProfileLog::run() {
+    constexpr juce::int64 rotateSize = 1 << 20;
+
+    while (!threadShouldExit()) {
+        wait(1000);
+
+        const ProfileReport report = profiler.collect(cursor);
+        if (report.blocks == 0) continue;
+
+        if (file.getSize() > rotateSize)
+            file.moveFileTo(file.withFileExtension("1.log"));
+
+        file.appendText(juce::Time::getCurrentTime().toISO8601(true) + "  " + report.toString() + "\n");
+    }
+}
+
+#endif
@@ -0,0 +1,172 @@
+#pragma once
+
+#include "APCommon.h"
+
+enum class ProfileStage {
+    inputGain,
+    upsampling,
+    curve,
+    downsampling,
+    outputGain,
+    // Up, curve and down in one pass, see PolyphaseIIROversampler::processFused
+    fused,
+    END
+};
+
+#if PROFILING_MODE
+
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <vector>
+
+#if JUCE_INTEL
+ #if JUCE_MSVC
+  #include <intrin.h>
+ #else
+  #include <x86intrin.h>
+ #endif
+#endif
+
+/**
+ * Counts on a log scale with 16 sub-bins per octave, so any value lands in a bin
+ * at most 1/16 wider than itself. Values under 16 get a bin each.
+ * Only the audio thread writes, counts are cumulative and never reset, readers
+ * diff two snapshots to get the counts of an interval.
+ */
+class LogHistogram {
+public:
+    static constexpr int subBins = 16;
+    static constexpr int numBins = subBins + (64 - 4) * subBins;
+
+    void add(juce::uint64 value) {
+        auto& bin = bins[static_cast<size_t>(binFor(value))];
+        bin.store(bin.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    juce::uint32 count(int bin) const { return bins[static_cast<size_t>(bin)].load(std::memory_order_relaxed); }
+
+    static int binFor(juce::uint64 value) {
+        if (value < subBins) return static_cast<int>(value);
+        const int octave = highestBit(value);
+        return subBins + (octave - 4) * subBins + static_cast<int>((value >> (octave - 4)) - subBins);
+    }
+
+    // Lower edge of the bin and its width
+    static double lowerBound(int bin) {
+        if (bin < subBins) return bin;
+        const int octave = (bin - subBins) / subBins + 4;
+        return std::ldexp(static_cast<double>(subBins + (bin - subBins) % subBins), octave - 4);
+    }
+
+    static double width(int bin) { return bin < subBins ? 1 : std::ldexp(1.0, (bin - subBins) / subBins); }
+
+private:
+    std::array<std::atomic<juce::uint32>, numBins> bins {};
+
+    static int highestBit(juce::uint64 value) {
+       #if JUCE_MSVC
+        unsigned long index;
+        _BitScanReverse64(&index, value);
+        return static_cast<int>(index);
+       #else
+        return 63 - __builtin_clzll(value);
+       #endif
+    }
+};
+
+struct ProfileStatistics {
+    double p50 = 0, p99 = 0, max = 0;
+};
+
+/**
+ * What happened since the previous collect with the same cursor.
+ * Stage times are in microseconds, budget is the block's processing time over its duration.
+ */
+struct ProfileReport {
+    juce::uint32 blocks = 0;
+    std::array<ProfileStatistics, static_cast<size_t>(ProfileStage::END)> stages;
+    ProfileStatistics budget;
+
+    juce::String toString() const;
+};
+
+// Counts seen by one reader at its last collect
+using ProfileCursor = std::vector<juce::uint32>;
+
+/**
+ * Times every stage of processBlock with the time stamp counter (the high resolution
+ * clock where there's none) into preallocated histograms.
+ * The audio thread only does a counter read and a relaxed increment per stage, any
+ * number of readers can collect reports, each with its own cursor.
+ */
+class BlockProfiler {
+public:
+    // Message thread, measures the counter rate once
+    void prepare(double sampleRate);
+
+    void beginBlock() {
+        blockStart = stageStart = readCounter();
+    }
+
+    void mark(ProfileStage stage) {
+        const juce::uint64 now = readCounter();
+        stages[static_cast<size_t>(stage)].add(now - stageStart);
+        stageStart = now;
+    }
+
+    // Budget histogram is kept in millionths of the block duration
+    void endBlock(int numSamples) {
+        const double blockCounts = countsPerSample.load(std::memory_order_relaxed) * numSamples;
+        if (blockCounts > 0)
+            budget.add(static_cast<juce::uint64>(static_cast<double>(stageStart - blockStart) / blockCounts * 1e6));
+    }
+
+    ProfileReport collect(ProfileCursor& cursor) const;
+
+    static juce::uint64 readCounter() {
+       #if JUCE_INTEL
+        return __rdtsc();
+       #else
+        return static_cast<juce::uint64>(juce::Time::getHighResolutionTicks());
+       #endif
+    }
+
+private:
+    std::array<LogHistogram, static_cast<size_t>(ProfileStage::END)> stages;
+    LogHistogram budget;
+
+    juce::uint64 blockStart = 0, stageStart = 0;
+    // Set in prepare while the log thread may be collecting
+    std::atomic<double> countsPerSecond { 1e9 }, countsPerSample { 0 };
+};
+
+/**
+ * Background thread appending a report line every second to a log file, which is
+ * rotated to a .1 file past a megabyte.
+ */
+class ProfileLog : private juce::Thread {
+public:
+    explicit ProfileLog(const BlockProfiler& profiler);
+    ~ProfileLog() override;
+
+private:
+    const BlockProfiler& profiler;
+    ProfileCursor cursor;
+    juce::File file;
+
+    void run() override;
+};
+
+#else
+
+// Compiled out, every call is an empty inline
+class BlockProfiler {
+public:
+    void prepare(double) {}
+    void beginBlock() {}
+    void mark(ProfileStage) {}
+    void endBlock(int) {}
+};
+
+#endif
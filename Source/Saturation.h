@@ -1,6 +1,12 @@
 #pragma once
 #include <cmath>
 
+/**
+ * Reference curves, templated on the sample type : float blocks use them where the
+ * fitted kernels don't apply, double blocks run them as they are. The float
+ * instantiations are the functions the curve registry and the kernels are keyed on.
+ */
+
 // We're not gonna have to bother with compile time so I can do this
 template <float (*Func)(float)>
 void performScaledSaturation(float* samples, size_t len,
@@ -9,63 +15,73 @@ void performScaledSaturation(float* samples, size_t len,
         samples[i] = outputG * Func(inputG * samples[i]);
 }
 
-template <float (*Func)(float)>
-void performSaturation(float* samples, size_t len) {
+template <auto Func, typename Sample>
+void performSaturation(Sample* samples, size_t len) {
     for(size_t i = 0; i < len; i++)
         samples[i] = Func(samples[i]);
 }
 
-inline float doSquaredSine(float sample) {
+template <typename Sample>
+Sample doSquaredSine(Sample sample) {
     return sample > 0 ? std::sin(sample * sample) : -std::sin(sample * sample);
 }
 
 constexpr float threshold = .9f;
-inline float doFold(float sample) {
-    sample = std::fmod(sample, 2.0f * threshold);
+template <typename Sample>
+Sample doFold(Sample sample) {
+    constexpr Sample fold = threshold;
+    sample = std::fmod(sample, 2 * fold);
 
-    if (sample > threshold)
-        return 2.0f * threshold - sample;
-    if (sample < -threshold)
-        return -2.0f * threshold - sample;
+    if (sample > fold)
+        return 2 * fold - sample;
+    if (sample < -fold)
+        return -2 * fold - sample;
 
     return sample;
 }
 
-inline float doCube(float sample) {
-    return std::sin(std::cbrt(sample) * .6f);
+template <typename Sample>
+Sample doCube(Sample sample) {
+    return std::sin(std::cbrt(sample) * Sample(.6f));
 }
 
-inline float doSqrt(float sample) {
-    sample = sample > 0 ? sqrtf(sample) : -sqrtf(-sample);
-    sample *= .6f;
-    return sample / powf(1 + powf(sample, 8), 1.0 / 8);
+template <typename Sample>
+Sample doSqrt(Sample sample) {
+    sample = sample > 0 ? std::sqrt(sample) : -std::sqrt(-sample);
+    sample *= Sample(.6f);
+    return sample / std::pow(1 + std::pow(sample, Sample(8)), Sample(1) / 8);
 }
 
-inline float doLog(float sample) {
+template <typename Sample>
+Sample doLog(Sample sample) {
     sample = sample > 0 ? std::log(1 + sample) : -std::log(1 - sample);
-    sample *= .6f;
-    return sample / powf(1 + powf(sample, 8), 1.0 / 8);
+    sample *= Sample(.6f);
+    return sample / std::pow(1 + std::pow(sample, Sample(8)), Sample(1) / 8);
 }
 
-inline float doHard(float sample) {
-    if(sample < -1e4f) return -1;
-    if(sample > 1e4f) return 1;
-    return sample / powf(1 + powf(sample, 8), 1.0 / 8);
+template <typename Sample>
+Sample doHard(Sample sample) {
+    if(sample < Sample(-1e4f)) return -1;
+    if(sample > Sample(1e4f)) return 1;
+    return sample / std::pow(1 + std::pow(sample, Sample(8)), Sample(1) / 8);
 }
 
-inline float doSine(float sample) {
+template <typename Sample>
+Sample doSine(Sample sample) {
     return std::sin(sample);
 }
 
-inline float doTanhStandard(float sample) {
+template <typename Sample>
+Sample doTanhStandard(Sample sample) {
     return std::tanh(sample);
 }
 
-inline float doAsym(float sample) {
+template <typename Sample>
+Sample doAsym(Sample sample) {
     if(sample < 0)
-        sample = -powf(sample, 8);
+        sample = -std::pow(sample, Sample(8));
 
-    if(sample < -1e4f) return -1;
-    if(sample > 1e4f) return 1;
-    return sample / powf(1 + powf(sample, 8), 1.f / 8);
-}
\ No newline at end of file
+    if(sample < Sample(-1e4f)) return -1;
+    if(sample > Sample(1e4f)) return 1;
+    return sample / std::pow(1 + std::pow(sample, Sample(8)), Sample(1) / 8);
+}
@@ -0,0 +1,417 @@
+#pragma once
+
+#include <cmath>
+#include <type_traits>
+#include <vector>
+
+#include "Curves.h"
+
+/**
+ * Antiderivative anti-aliasing (Parker et al. 2016, Bilbao et al. 2017).
+ *
+ * First order : y[n] = (F1(x[n]) - F1(x[n-1])) / (x[n] - x[n-1]), half a sample of delay.
+ * Second order : y[n] = 2 / (x[n] - x[n-2]) * (D(x[n], x[n-1]) - D(x[n-1], x[n-2]))
+ *                with D(a, b) = (F2(a) - F2(b)) / (a - b), one sample of delay.
+ *
+ * Everything runs in double : the differences cancel most of the antiderivative's
+ * magnitude and F2 grows like x^2. The ill-conditioning threshold is relative to |x|
+ * for the same reason, below it the quotients are replaced by their limits.
+ * Samples come in and go out at the block's precision, float or double.
+ */
+
+/**
+ * F1 and F2 baked as cubic Hermite segments for the curves without a usable closed form.
+ * Segments are cubic in the axis coordinate v and the node slopes are the exact
+ * derivatives (f * dx/dv for F1, F1 * dx/dv for F2), so the interpolant's difference
+ * quotients stay close to the averages of f ADAA is after.
+ *
+ * Compressed axes use v = x / (1 + |x|), square root axes v = sign(x) * sqrt|x| which
+ * turns the x^1.5 cusp of sqrt's F1 at 0 into a smooth v^3.
+ */
+class AntiderivativeTable {
+public:
+    enum class Axis { uniform, compressed, squareRoot };
+
+    void build(float (*curve)(float), double extent, Axis axis, int cells) {
+        this->axis = axis;
+        this->cells = cells;
+        this->extent = extent;
+        span = toAxis(extent);
+
+        nodes.resize(static_cast<size_t>(cells) + 1);
+        for (int i = 0; i <= cells; i++) {
+            Node& node = nodes[static_cast<size_t>(i)];
+            node.v = -span + 2 * span * i / cells;
+            node.x = fromAxis(node.v);
+            node.dx = slope(node.v);
+            node.f = curve(static_cast<float>(node.x));
+        }
+
+        const size_t middle = static_cast<size_t>(cells / 2);
+        nodes[middle].F1 = 0;
+        nodes[middle].F2 = 0;
+
+        for (size_t i = middle; i < static_cast<size_t>(cells); i++)
+            integrate(curve, nodes[i], nodes[i + 1]);
+
+        for (size_t i = middle; i > 0; i--)
+            integrate(curve, nodes[i], nodes[i - 1]);
+    }
+
+    bool isBuilt() const { return !nodes.empty(); }
+
+    double getExtent() const { return extent; }
+
+    // Values at +-extent, where the curves hand over to their asymptotic forms
+    double edgeF1(bool positive) const { return (positive ? nodes.back() : nodes.front()).F1; }
+    double edgeF2(bool positive) const { return (positive ? nodes.back() : nodes.front()).F2; }
+
+    // Only valid for |x| <= extent
+    void evaluate(double x, double& F1, double& F2) const {
+        const double v = toAxis(x);
+        int i = static_cast<int>((v + span) * cells / (2 * span));
+        i = i < 0 ? 0 : (i > cells - 1 ? cells - 1 : i);
+
+        const Node& a = nodes[static_cast<size_t>(i)];
+        const Node& b = nodes[static_cast<size_t>(i) + 1];
+        interpolate(a, b, (v - a.v) / (b.v - a.v), F1, F2);
+    }
+
+private:
+    struct Node {
+        double v = 0, x = 0, dx = 0, f = 0, F1 = 0, F2 = 0;
+    };
+
+    std::vector<Node> nodes;
+    Axis axis = Axis::uniform;
+    int cells = 0;
+    double extent = 0, span = 0;
+
+    double toAxis(double x) const {
+        switch (axis) {
+            case Axis::compressed: return x / (1 + std::abs(x));
+            case Axis::squareRoot: return x < 0 ? -std::sqrt(-x) : std::sqrt(x);
+            default: return x;
+        }
+    }
+
+    double fromAxis(double v) const {
+        switch (axis) {
+            case Axis::compressed: return v / (1 - std::abs(v));
+            case Axis::squareRoot: return v * std::abs(v);
+            default: return v;
+        }
+    }
+
+    // dx/dv
+    double slope(double v) const {
+        switch (axis) {
+            case Axis::compressed: return 1 / ((1 - std::abs(v)) * (1 - std::abs(v)));
+            case Axis::squareRoot: return 2 * std::abs(v);
+            default: return 1;
+        }
+    }
+
+    static void interpolate(const Node& a, const Node& b, double t, double& F1, double& F2) {
+        const double h = b.v - a.v;
+        const double t2 = t * t, t3 = t2 * t;
+        const double h00 = 2 * t3 - 3 * t2 + 1, h10 = t3 - 2 * t2 + t;
+        const double h01 = -2 * t3 + 3 * t2, h11 = t3 - t2;
+
+        F1 = h00 * a.F1 + h10 * h * a.f * a.dx + h01 * b.F1 + h11 * h * b.f * b.dx;
+        F2 = h00 * a.F2 + h10 * h * a.F1 * a.dx + h01 * b.F2 + h11 * h * b.F1 * b.dx;
+    }
+
+    /**
+     * Fills to.F1 and to.F2 from from's values with 5 point Gauss-Legendre in v,
+     * either direction works. F1 integrates f * dx/dv, F2 integrates the cell's own
+     * F1 interpolant so the stored F2 agrees with what evaluate returns.
+     */
+    void integrate(float (*curve)(float), const Node& from, Node& to) const {
+        static const double gaussX[] = { 0.0, -0.5384693101056831, 0.5384693101056831, -0.9061798459386640, 0.9061798459386640 };
+        static const double gaussW[] = { 0.5688888888888889, 0.4786286704993665, 0.4786286704993665, 0.2369268850561891, 0.2369268850561891 };
+
+        const double h = to.v - from.v;
+
+        double area = 0;
+        for (int k = 0; k < 5; k++) {
+            const double v = from.v + (gaussX[k] + 1) * h / 2;
+            area += gaussW[k] * curve(static_cast<float>(fromAxis(v))) * slope(v);
+        }
+        to.F1 = from.F1 + area * h / 2;
+
+        double area2 = 0;
+        for (int k = 0; k < 5; k++) {
+            const double t = (gaussX[k] + 1) / 2;
+            double F1, F2;
+            interpolate(from, to, t, F1, F2);
+            area2 += gaussW[k] * F1 * slope(from.v + t * h);
+        }
+        to.F2 = from.F2 + area2 * h / 2;
+    }
+};
+
+struct AntiderivativeTables {
+    AntiderivativeTable tanh, hard, log, sqrt, squaredSine, asym;
+
+    // Shared by every instance, nothing in here depends on the sample rate
+    static const AntiderivativeTables& getInstance() {
+        static const AntiderivativeTables instance;
+        return instance;
+    }
+
+private:
+    // Extents are where the curve is +-1 within float precision, or for squaredSine
+    // where its asymptotic expansion takes over
+    AntiderivativeTables() {
+        tanh.build(doTanhStandard, 9, AntiderivativeTable::Axis::compressed, 2048);
+        hard.build(doHard, 16, AntiderivativeTable::Axis::compressed, 2048);
+        log.build(doLog, 1.2e5, AntiderivativeTable::Axis::compressed, 2048);
+        sqrt.build(doSqrt, 712, AntiderivativeTable::Axis::squareRoot, 2048);
+        squaredSine.build(doSquaredSine, 16, AntiderivativeTable::Axis::uniform, 8192);
+        asym.build(doAsym, 16, AntiderivativeTable::Axis::compressed, 2048);
+    }
+};
+
+// Tabulated curve that is a constant +-1 past the table extent
+inline void saturatingAntiderivatives(const AntiderivativeTable& table, double x, double& F1, double& F2) {
+    const double extent = table.getExtent();
+
+    if (std::abs(x) <= extent) {
+        table.evaluate(x, F1, F2);
+        return;
+    }
+
+    const bool positive = x > 0;
+    const double d = positive ? x - extent : x + extent;
+    const double limit = positive ? 1 : -1;
+    const double edgeF1 = table.edgeF1(positive);
+
+    F1 = edgeF1 + limit * d;
+    F2 = table.edgeF2(positive) + edgeF1 * d + limit * d * d / 2;
+}
+
+/**
+ * Antiderivatives for each curve, F1(0) = F2(0) = 0.
+ * sine, cube and fold have closed forms, the others go through AntiderivativeTables.
+ */
+template <float (*Func)(float)>
+struct Antiderivative;
+
+#define AP_TABULATED_ANTIDERIVATIVE(reference, table)                                                  \
+    template <>                                                                                         \
+    struct Antiderivative<reference> {                                                                  \
+        static void evaluate(const AntiderivativeTables& tables, double x, double& F1, double& F2) {   \
+            saturatingAntiderivatives(tables.table, x, F1, F2);                                         \
+        }                                                                                               \
+    };
+
+AP_TABULATED_ANTIDERIVATIVE(doTanhStandard, tanh)
+AP_TABULATED_ANTIDERIVATIVE(doHard, hard)
+AP_TABULATED_ANTIDERIVATIVE(doLog, log)
+AP_TABULATED_ANTIDERIVATIVE(doSqrt, sqrt)
+AP_TABULATED_ANTIDERIVATIVE(doAsym, asym)
+
+#undef AP_TABULATED_ANTIDERIVATIVE
+
+template <>
+struct Antiderivative<doSine> {
+    static void evaluate(const AntiderivativeTables&, double x, double& F1, double& F2) {
+        F1 = 1 - std::cos(x);
+        F2 = x - std::sin(x);
+    }
+};
+
+/**
+ * sin(a * cbrt(x)) : with u = cbrt(x), dx = 3u^2 du, so both antiderivatives
+ * are polynomials in u times sin(au) and cos(au).
+ */
+template <>
+struct Antiderivative<doCube> {
+    static void evaluate(const AntiderivativeTables&, double x, double& F1, double& F2) {
+        constexpr double a = .6f;
+        const double u = std::cbrt(x);
+        const double s = std::sin(a * u), c = std::cos(a * u);
+        const double u2 = u * u, u3 = u2 * u, u4 = u2 * u2;
+        const double a2 = a * a, a3 = a2 * a, a4 = a2 * a2, a5 = a4 * a;
+
+        F1 = 3 * (-u2 * c / a + 2 * u * s / a2 + 2 * (c - 1) / a3);
+
+        const double u4Cos = u4 * s / a + 4 * u3 * c / a2 - 12 * u2 * s / a3 - 24 * u * c / a4 + 24 * s / a5;
+        const double u3Sin = -u3 * c / a + 3 * u2 * s / a2 + 6 * u * c / a3 - 6 * s / a4;
+        const double u2Cos = u2 * s / a + 2 * u * c / a2 - 2 * s / a3;
+        F2 = 9 * (-u4Cos / a + 2 * u3Sin / a2 + 2 * u2Cos / a3 - 2 * u3 / (3 * a3));
+    }
+};
+
+/**
+ * For x >= 0 fold is a triangle of period P = 2 * threshold and area T^2 per period,
+ * so F1 = n * T^2 + G(r) and F2 sums n whole periods plus H(r), with x = n * P + r.
+ * F1 is even and F2 odd.
+ */
+template <>
+struct Antiderivative<doFold> {
+    static void evaluate(const AntiderivativeTables&, double x, double& F1, double& F2) {
+        constexpr double T = threshold;
+        constexpr double P = 2 * T;
+        constexpr double area = T * T;
+
+        const double ax = std::abs(x);
+        const double n = std::floor(ax / P);
+        double r = ax - n * P;
+        r = r < 0 ? 0 : (r > P ? P : r);
+
+        const double G = r <= T ? r * r / 2
+                                : T * T / 2 + P * (r - T) - (r * r - T * T) / 2;
+        const double H = r <= T ? r * r * r / 6
+                                : T * T * T / 6 + T * T / 2 * (r - T) + P * (r - T) * (r - T) / 2
+                                  - ((r * r * r - T * T * T) / 3 - T * T * (r - T)) / 2;
+
+        // H over a whole period
+        const double B = T * T * T / 6 + T * T * T / 2 + P * T * T / 2 - ((P * P * P - T * T * T) / 3 - T * T * T) / 2;
+
+        F1 = n * area + G;
+        F2 = area * P * n * (n - 1) / 2 + n * B + n * area * r + H;
+        if (x < 0) F2 = -F2;
+    }
+};
+
+/**
+ * Past the table, F1 follows the Fresnel asymptote sqrt(pi/8) + A(x) and F2 the matching
+ * Ci(x^2) expansion B(x), both offset to meet the table at its edge.
+ */
+template <>
+struct Antiderivative<doSquaredSine> {
+    static double A(double x) {
+        const double w = x * x;
+        return -std::cos(w) / (2 * x) - std::sin(w) / (4 * x * w);
+    }
+
+    static double B(double x) {
+        const double w = x * x;
+        return -std::sin(w) / (4 * w) + 3 * std::cos(w) / (8 * w * w) + 3 * std::sin(w) / (4 * w * w * w);
+    }
+
+    static void evaluate(const AntiderivativeTables& tables, double x, double& F1, double& F2) {
+        const AntiderivativeTable& table = tables.squaredSine;
+        const double X = table.getExtent();
+
+        if (std::abs(x) <= X) {
+            table.evaluate(x, F1, F2);
+            return;
+        }
+
+        const double ax = std::abs(x);
+        const double edgeF1 = table.edgeF1(true);
+
+        F1 = edgeF1 + A(ax) - A(X);
+        F2 = table.edgeF2(true) + (edgeF1 - A(X)) * (ax - X) + B(ax) - B(X);
+        if (x < 0) F2 = -F2;
+    }
+};
+
+struct ADAAChannelState {
+    float (*curve)(float) = nullptr;
+    int order = 0;
+    double x1 = 0, x2 = 0;
+    double F1x1 = 0, F2x1 = 0;
+    double D12 = 0;
+};
+
+// Below this the difference quotients lose more than a few float ulps to rounding
+inline bool isIllConditioned(double dx, double x) {
+    return std::abs(dx) < 1e-5 * (1 + std::abs(x));
+}
+
+// The curve itself at the block's precision, for where the quotients are replaced by their limits
+template <float (*Func)(float), typename Sample>
+Sample evaluateCurve(double x) {
+    if constexpr (std::is_same_v<Sample, float>) {
+        return Func(static_cast<float>(x));
+    } else {
+        constexpr auto reference = doubleFunctionOf<Func>();
+        static_assert(reference != nullptr, "ADAA runs on registry curves");
+        return static_cast<Sample>(reference(x));
+    }
+}
+
+template <float (*Func)(float)>
+double adaaDifference(const AntiderivativeTables& tables, double x0, double F2x0, double x1, double F2x1) {
+    const double dx = x0 - x1;
+    if (isIllConditioned(dx, x0)) {
+        double F1, F2;
+        Antiderivative<Func>::evaluate(tables, (x0 + x1) / 2, F1, F2);
+        return F1;
+    }
+    return (F2x0 - F2x1) / dx;
+}
+
+// Re-derives the cached antiderivatives after a curve or order change, keeping the input history
+template <float (*Func)(float)>
+void primeADAA(const AntiderivativeTables& tables, ADAAChannelState& state, int order) {
+    double F1x2, F2x2;
+    Antiderivative<Func>::evaluate(tables, state.x1, state.F1x1, state.F2x1);
+    Antiderivative<Func>::evaluate(tables, state.x2, F1x2, F2x2);
+    state.D12 = adaaDifference<Func>(tables, state.x1, state.F2x1, state.x2, F2x2);
+    state.curve = Func;
+    state.order = order;
+}
+
+template <float (*Func)(float), typename Sample>
+void performSaturationADAA1(const AntiderivativeTables& tables, ADAAChannelState& state, Sample* samples, size_t len) {
+    if (state.curve != Func || state.order != 1) primeADAA<Func>(tables, state, 1);
+
+    for (size_t i = 0; i < len; i++) {
+        const double x0 = samples[i];
+        double F1x0, F2x0;
+        Antiderivative<Func>::evaluate(tables, x0, F1x0, F2x0);
+
+        const double dx = x0 - state.x1;
+        samples[i] = isIllConditioned(dx, x0)
+                   ? evaluateCurve<Func, Sample>((x0 + state.x1) / 2)
+                   : static_cast<Sample>((F1x0 - state.F1x1) / dx);
+
+        state.x2 = state.x1;
+        state.x1 = x0;
+        state.F1x1 = F1x0;
+        state.F2x1 = F2x0;
+    }
+}
+
+template <float (*Func)(float), typename Sample>
+void performSaturationADAA2(const AntiderivativeTables& tables, ADAAChannelState& state, Sample* samples, size_t len) {
+    if (state.curve != Func || state.order != 2) primeADAA<Func>(tables, state, 2);
+
+    for (size_t i = 0; i < len; i++) {
+        const double x0 = samples[i];
+        double F1x0, F2x0;
+        Antiderivative<Func>::evaluate(tables, x0, F1x0, F2x0);
+
+        const double D01 = adaaDifference<Func>(tables, x0, F2x0, state.x1, state.F2x1);
+        const double dx = x0 - state.x2;
+
+        double y;
+        if (!isIllConditioned(dx, x0)) {
+            y = 2 * (D01 - state.D12) / dx;
+        } else {
+            // x[n] ~ x[n-2] : integrate f against the triangle around x[n-1] directly
+            const double xBar = (x0 + state.x2) / 2;
+            const double delta = xBar - state.x1;
+
+            if (isIllConditioned(delta, xBar)) {
+                y = evaluateCurve<Func, Sample>((xBar + state.x1) / 2);
+            } else {
+                double F1Bar, F2Bar;
+                Antiderivative<Func>::evaluate(tables, xBar, F1Bar, F2Bar);
+                y = 2 / delta * (F1Bar + (state.F2x1 - F2Bar) / delta);
+            }
+        }
+        samples[i] = static_cast<Sample>(y);
+
+        state.x2 = state.x1;
+        state.x1 = x0;
+        state.F1x1 = F1x0;
+        state.F2x1 = F2x0;
+        state.D12 = D01;
+    }
+}
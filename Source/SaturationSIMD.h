@@ -0,0 +1,245 @@
+#pragma once
+
+#include "APSIMD.h"
+#include "Saturation.h"
+
+/**
+ * Branch-free, libm-free versions of the curves in Saturation.h.
+ * Every function is templated on the lane pack so the same code runs on
+ * SIMDRegisterLanes<float> for the bulk of a block and ScalarLanes<float> for the tail.
+ *
+ * Max abs error against the reference curves over |x| <= 1e4 (|x| <= 64 for
+ * squaredSine, whose argument has no precision left past that):
+ *   tanh 3.6e-7, sine 1.8e-7, hard 2.4e-7, log 1.8e-7, sqrt 2.4e-7, asym 2.4e-7,
+ *   cube 3.6e-7 (2.9e-6 near 1e4, the reference itself rounds the sin argument),
+ *   squaredSine 1.8e-7, fold exact for |x| < 2^29.
+ * Past those ranges the output stays bounded but follows the reference loosely.
+ */
+
+// Cephes expf, valid for x in [-87, 88]
+template <typename L>
+L fastExp(L x) {
+    x = min(max(x, L(-87.3f)), L(88.3f));
+
+    L n = floor(x * 1.44269504088896341f + .5f);
+    x = x - n * .693359375f;
+    x = x + n * 2.12194440e-4f;
+
+    L z = x * x;
+    L p = 1.9875691500e-4f;
+    p = p * x + 1.3981999507e-3f;
+    p = p * x + 8.3334519073e-3f;
+    p = p * x + 4.1665795894e-2f;
+    p = p * x + 1.6666665459e-1f;
+    p = p * x + 5.0000001201e-1f;
+    p = p * z + x + 1.0f;
+
+    // 2^n built straight into the exponent field
+    auto bits = (truncateToInt(n) + 127) << 23;
+    return p * fromBits<float>(bits);
+}
+
+// Cephes logf, valid for normal positive x
+template <typename L>
+L fastLog(L x) {
+    auto bits = toBits(x);
+    L e = toFloatingPoint<float>((bits >> 23) - 127);
+    L m = fromBits<float>((bits & 0x007fffff) | 0x3f800000);
+
+    // Keep the mantissa in [sqrt(.5), sqrt(2)) so the polynomial stays accurate
+    auto big = m > 1.41421356f;
+    m = select(big, m * .5f, m);
+    e = select(big, e + 1.0f, e);
+
+    L z = m - 1.0f;
+    L z2 = z * z;
+    L p = 7.0376836292e-2f;
+    p = p * z - 1.1514610310e-1f;
+    p = p * z + 1.1676998740e-1f;
+    p = p * z - 1.2420140846e-1f;
+    p = p * z + 1.4249322787e-1f;
+    p = p * z - 1.6668057665e-1f;
+    p = p * z + 2.0000714765e-1f;
+    p = p * z - 2.4999993993e-1f;
+    p = p * z + 3.3333331174e-1f;
+    p = p * z * z2;
+
+    p = p + e * -2.12194440e-4f;
+    p = p - z2 * .5f;
+    return z + p + e * .693359375f;
+}
+
+/**
+ * sin(x) = (-1)^k * sin(x - k*pi), k = round(x/pi), with a 3 part pi so the
+ * reduction stays exact for moderate k. Arguments are clamped so the integer
+ * conversion can't overflow, past that sin is noise in float anyway.
+ */
+template <typename L>
+L fastSin(L x) {
+    x = min(max(x, L(-4194304.0f)), L(4194304.0f));
+
+    L k = floor(x * .318309886183790671f + .5f);
+    x = x - k * 3.140625f;
+    x = x - k * 9.67502593994140625e-4f;
+    x = x - k * 1.509957990978376432e-7f;
+
+    L x2 = x * x;
+    L p = 2.50521083854e-8f;
+    p = p * x2 - 2.75573192240e-6f;
+    p = p * x2 + 1.98412698413e-4f;
+    p = p * x2 - 8.33333333333e-3f;
+    p = p * x2 + 1.66666666667e-1f;
+    p = x - p * x2 * x;
+
+    auto odd = (truncateToInt(k) & 1) == 1;
+    return select(odd, -p, p);
+}
+
+// Both for x >= 0, seeded through exp/log and polished with one Newton step
+template <typename L>
+L fastSqrt(L x) {
+    L y = fastExp(fastLog(max(x, L(1.17549435e-38f))) * .5f);
+    return select(x > 0.0f, (y + x / y) * .5f, L(0.0f));
+}
+
+template <typename L>
+L fastCbrt(L x) {
+    L y = fastExp(fastLog(max(x, L(1.17549435e-38f))) * (1.0f / 3));
+    return select(x > 0.0f, (y + y + x / (y * y)) * (1.0f / 3), L(0.0f));
+}
+
+/**
+ * Shared tail of doHard/doSqrt/doLog/doAsym : x / (1 + x^8)^(1/8).
+ * Past |x| = 16 the result is 1 within float precision, which also keeps x^8 finite.
+ */
+template <typename L>
+L hardShape(L x) {
+    L a = min(abs(x), L(16.0f));
+    L a2 = a * a;
+    L a4 = a2 * a2;
+    L y = a * fastExp(fastLog(a4 * a4 + 1.0f) * -.125f);
+    return select(x < 0.0f, -y, y);
+}
+
+// Rational minimax fit of tanh, clamped where it reaches 1 in float
+template <typename L>
+L doTanhSIMD(L x) {
+    L c = min(max(x, L(-7.90531110763549805f)), L(7.90531110763549805f));
+    L x2 = c * c;
+
+    L p = -2.76076847742355e-16f;
+    p = p * x2 + 2.00018790482477e-13f;
+    p = p * x2 - 8.60467152213735e-11f;
+    p = p * x2 + 5.12229709037114e-08f;
+    p = p * x2 + 1.48572235717979e-05f;
+    p = p * x2 + 6.37261928875436e-04f;
+    p = p * x2 + 4.89352455891786e-03f;
+    p = p * c;
+
+    L q = 1.19825839466702e-06f;
+    q = q * x2 + 1.18534705686654e-04f;
+    q = q * x2 + 2.26843463243900e-03f;
+    q = q * x2 + 4.89352518554385e-03f;
+
+    return select(abs(x) < .0004f, x, p / q);
+}
+
+template <typename L>
+L doSineSIMD(L x) {
+    return fastSin(x);
+}
+
+template <typename L>
+L doHardSIMD(L x) {
+    return hardShape(x);
+}
+
+template <typename L>
+L doLogSIMD(L x) {
+    L s = fastLog(abs(x) + 1.0f) * .6f;
+    return hardShape(select(x > 0.0f, s, -s));
+}
+
+template <typename L>
+L doSqrtSIMD(L x) {
+    L s = fastSqrt(abs(x)) * .6f;
+    return hardShape(select(x > 0.0f, s, -s));
+}
+
+template <typename L>
+L doCubeSIMD(L x) {
+    L s = fastCbrt(abs(x)) * .6f;
+    return fastSin(select(x < 0.0f, -s, s));
+}
+
+/**
+ * fmod done in double : n * period is exact for |n| < 2^29 so the remainder is the
+ * same as std::fmod, the round to nearest trick needs |x / period| < 2^51.
+ */
+template <typename L>
+L doFoldSIMD(L x) {
+    using D = SIMDLanes<double, L::width>;
+    constexpr double period = 2.0f * threshold;
+    constexpr double roundingMagic = 6755399441055744.0;
+
+    D xd = toFloatingPoint<double>(x);
+    xd = min(max(xd, D(-1e15)), D(1e15));
+
+    D n = (xd / period + roundingMagic) - roundingMagic;
+    D r = xd - n * period;
+    r = select((xd >= 0.0) & (r < 0.0), r + period, r);
+    r = select((xd < 0.0) & (r > 0.0), r - period, r);
+
+    L s = toFloatingPoint<float>(r);
+    s = select(s > threshold, 2.0f * threshold - s, s);
+    s = select(s < -threshold, -2.0f * threshold - s, s);
+    return s;
+}
+
+template <typename L>
+L doSquaredSineSIMD(L x) {
+    L s = fastSin(x * x);
+    return select(x > 0.0f, s, -s);
+}
+
+template <typename L>
+L doAsymSIMD(L x) {
+    L x2 = x * x;
+    L x4 = x2 * x2;
+    return hardShape(select(x < 0.0f, -(x4 * x4), x));
+}
+
+// Maps each reference curve to its vectorized counterpart
+template <float (*Func)(float)>
+struct SIMDSaturation;
+
+#define AP_SIMD_SATURATION(reference, vectorized)           \
+    template <>                                             \
+    struct SIMDSaturation<reference> {                      \
+        template <typename L>                               \
+        static L process(L x) { return vectorized(x); }     \
+    };
+
+AP_SIMD_SATURATION(doTanhStandard, doTanhSIMD)
+AP_SIMD_SATURATION(doSine, doSineSIMD)
+AP_SIMD_SATURATION(doHard, doHardSIMD)
+AP_SIMD_SATURATION(doLog, doLogSIMD)
+AP_SIMD_SATURATION(doSqrt, doSqrtSIMD)
+AP_SIMD_SATURATION(doCube, doCubeSIMD)
+AP_SIMD_SATURATION(doFold, doFoldSIMD)
+AP_SIMD_SATURATION(doSquaredSine, doSquaredSineSIMD)
+AP_SIMD_SATURATION(doAsym, doAsymSIMD)
+
+#undef AP_SIMD_SATURATION
+
+template <float (*Func)(float)>
+void performSaturationSIMD(float* samples, size_t len) {
+    using Lanes = SIMDRegisterLanes<float>;
+
+    size_t i = 0;
+    for (; i + Lanes::width <= len; i += Lanes::width)
+        SIMDSaturation<Func>::process(Lanes::load(samples + i)).store(samples + i);
+
+    for (; i < len; i++)
+        samples[i] = SIMDSaturation<Func>::process(ScalarLanes<float>(samples[i]))[0];
+}
@@ -0,0 +1,187 @@
+#pragma once
+
+#include <vector>
+
+#include "SaturationSIMD.h"
+
+enum class TableInterpolation {
+    linear,
+    cubic
+};
+
+/**
+ * One curve baked into size + 1 points, read back with linear or Catmull-Rom cubic
+ * Hermite interpolation. 4096 intervals keep a table at 16 KB so the active one stays in L1.
+ *
+ * Compressed tables index u = x / (1 + |x|), which maps the whole real line onto [-1, 1]:
+ * the two end points hold the curve's analytic limits at +-infinity and no input is ever
+ * out of range. Periodic tables index x modulo the period.
+ */
+class SaturationTable {
+public:
+    static constexpr int size = 4096;
+
+    void buildCompressed(float (*curve)(float), float lowLimit, float highLimit) {
+        allocate();
+        for (int i = 0; i <= size; i++) {
+            const double u = -1.0 + 2.0 * i / size;
+
+            if (i == 0) at(i) = lowLimit;
+            else if (i == size) at(i) = highLimit;
+            else at(i) = curve(static_cast<float>(u / (1.0 - std::abs(u))));
+        }
+        // Flat past both ends, the curve has reached its limit there
+        at(-1) = lowLimit;
+        at(size + 1) = highLimit;
+
+        inversePeriod = 0;
+    }
+
+    void buildPeriodic(float (*curve)(float), double period) {
+        allocate();
+        for (int i = 0; i <= size; i++)
+            at(i) = curve(static_cast<float>(period * i / size));
+        at(-1) = at(size - 1);
+        at(size + 1) = at(1);
+
+        // Cody-Waite split : periodHigh keeps 12 bits so k * periodHigh is exact for k < 4096
+        int exponent;
+        std::frexp(period, &exponent);
+        const double quantum = std::ldexp(1.0, 12 - exponent);
+        periodHigh = static_cast<float>(std::round(period * quantum) / quantum);
+        periodLow = static_cast<float>(period - periodHigh);
+        inversePeriod = static_cast<float>(1.0 / period);
+        this->period = static_cast<float>(period);
+    }
+
+    bool isBuilt() const { return !values.empty(); }
+
+    template <TableInterpolation interpolation, typename L>
+    L processCompressed(L x) const {
+        x = min(max(x, L(-1e18f)), L(1e18f));
+        L u = x / (abs(x) + 1.0f);
+        return lookup<interpolation>((u + 1.0f) * (size * .5f));
+    }
+
+    template <TableInterpolation interpolation, typename L>
+    L processPeriodic(L x) const {
+        x = min(max(x, L(-4194304.0f)), L(4194304.0f));
+
+        L k = floor(x * inversePeriod);
+        L r = x - k * periodHigh;
+        r = r - k * periodLow;
+
+        // The quotient can round across an integer, fold the remainder back into [0, period)
+        r = select(r < 0.0f, r + period, r);
+        r = select(r >= period, r - period, r);
+        return lookup<interpolation>(r * (inversePeriod * size));
+    }
+
+private:
+    std::vector<float> values;
+
+    float period = 0, periodHigh = 0, periodLow = 0, inversePeriod = 0;
+
+    void allocate() { values.assign(size + 3, 0.0f); }
+
+    // Index -1 and size + 1 are guard points for the cubic stencil
+    float& at(int i) { return values[static_cast<size_t>(i + 1)]; }
+
+    template <TableInterpolation interpolation, typename L>
+    L lookup(L position) const {
+        position = min(max(position, L(0.0f)), L(static_cast<float>(size)));
+
+        auto index = min(truncateToInt(position), decltype(truncateToInt(position))(size - 1));
+        L t = position - toFloatingPoint<float>(index);
+
+        const float* table = values.data() + 1;
+        L p1 = gather(table, index);
+        L p2 = gather(table + 1, index);
+
+        if constexpr (interpolation == TableInterpolation::linear) {
+            return p1 + t * (p2 - p1);
+        } else {
+            L p0 = gather(table - 1, index);
+            L p3 = gather(table + 2, index);
+
+            L c1 = (p2 - p0) * .5f;
+            L c2 = p0 - p1 * 2.5f + p2 * 2.0f - p3 * .5f;
+            L c3 = (p3 - p0) * .5f + (p1 - p2) * 1.5f;
+            return ((c3 * t + c2) * t + c1) * t + p1;
+        }
+    }
+};
+
+/**
+ * The four tables every curve is built from. Curves that are a cheap transform of one
+ * of them reuse it : sqrt and asym go through the hard table, cube and squaredSine
+ * through the sine table, which keeps the singular slopes of sqrt and cbrt at 0
+ * out of the interpolation. Fold is already a handful of exact operations and
+ * doesn't get a table.
+ *
+ * Max abs error against the reference curves, |x| <= 1e4 (|x| <= 64 for squaredSine),
+ * the larger of the SSE and AVX2/FMA builds:
+ *                linear     cubic
+ *   tanh         4.2e-7     3.6e-7
+ *   sine         8.6e-7     8.9e-7     (float rounding of the baked grid positions)
+ *   hard         1.0e-6     4.8e-7
+ *   log          6.6e-7     4.8e-7
+ *   sqrt         1.1e-6     4.8e-7
+ *   cube         3.3e-6     3.3e-6     (same argument rounding as the SIMD kernel)
+ *   fold         exact      exact
+ *   squaredSine  8.5e-7     9.1e-7
+ *   asym         1.0e-6     4.8e-7
+ */
+struct SaturationTables {
+    SaturationTable tanh, hard, log, sine;
+
+    void build() {
+        if (isBuilt()) return;
+
+        tanh.buildCompressed(doTanhStandard, -1, 1);
+        hard.buildCompressed(doHard, -1, 1);
+        log.buildCompressed(doLog, -1, 1);
+        sine.buildPeriodic(doSine, juce::MathConstants<double>::twoPi);
+    }
+
+    bool isBuilt() const { return sine.isBuilt(); }
+};
+
+// Maps each reference curve to its table evaluation, same layout as SIMDSaturation
+template <float (*Func)(float)>
+struct TableSaturation;
+
+#define AP_TABLE_SATURATION(reference, expression)                                     \
+    template <>                                                                         \
+    struct TableSaturation<reference> {                                                 \
+        template <TableInterpolation interpolation, typename L>                         \
+        static L process([[maybe_unused]] const SaturationTables& tables, L x) { return expression; } \
+    };
+
+AP_TABLE_SATURATION(doTanhStandard, tables.tanh.processCompressed<interpolation>(x))
+AP_TABLE_SATURATION(doSine, tables.sine.processPeriodic<interpolation>(x))
+AP_TABLE_SATURATION(doHard, tables.hard.processCompressed<interpolation>(x))
+AP_TABLE_SATURATION(doLog, tables.log.processCompressed<interpolation>(x))
+AP_TABLE_SATURATION(doSqrt, tables.hard.processCompressed<interpolation>(
+                                select(x > 0.0f, L(.6f), L(-.6f)) * sqrt(abs(x))))
+AP_TABLE_SATURATION(doCube, tables.sine.processPeriodic<interpolation>(
+                                select(x < 0.0f, L(-.6f), L(.6f)) * fastCbrt(abs(x))))
+AP_TABLE_SATURATION(doFold, doFoldSIMD(x))
+AP_TABLE_SATURATION(doSquaredSine, select(x > 0.0f, L(1.0f), L(-1.0f))
+                                * tables.sine.processPeriodic<interpolation>(x * x))
+AP_TABLE_SATURATION(doAsym, tables.hard.processCompressed<interpolation>(
+                                select(x < 0.0f, -(x * x * x * x * x * x * x * x), x)))
+
+#undef AP_TABLE_SATURATION
+
+template <float (*Func)(float), TableInterpolation interpolation>
+void performSaturationTable(const SaturationTables& tables, float* samples, size_t len) {
+    using Lanes = SIMDRegisterLanes<float>;
+
+    size_t i = 0;
+    for (; i + Lanes::width <= len; i += Lanes::width)
+        TableSaturation<Func>::template process<interpolation>(tables, Lanes::load(samples + i)).store(samples + i);
+
+    for (; i < len; i++)
+        samples[i] = TableSaturation<Func>::template process<interpolation>(tables, ScalarLanes<float>(samples[i]))[0];
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <algorithm>
+#include <JuceHeader.h>
+
+/**
+ * Tells when the output is known to be silent : whatever the input could come out as,
+ * after the gains and the curves, has stayed below -160 dBFS for at least the tail of
+ * everything after them, and still does. The caller bounds that level from the block's
+ * peak, the detector only counts.
+ * Entering that state is reported once so the caller can clear its filter history,
+ * which by then has rung out for its whole tail, and resume from it.
+ */
+class SilenceDetector {
+public:
+    static constexpr float threshold = 1e-8f;
+
+    void reset() {
+        silentSamples = 0;
+        idle = entered = false;
+    }
+
+    // Largest magnitude in the block
+    template <typename Sample>
+    static float findPeak(const Sample* const* channels, size_t numChannels, size_t numSamples) {
+        Sample peak = 0;
+        for (size_t channel = 0; channel < numChannels; channel++) {
+            const auto range = juce::FloatVectorOperations::findMinAndMax(channels[channel], static_cast<int>(numSamples));
+            peak = std::max({ peak, -range.getStart(), range.getEnd() });
+        }
+        return static_cast<float>(peak);
+    }
+
+    // Once per block before processing with the loudest the block could come out, true when it can be skipped
+    bool update(float outputBound, size_t numSamples, int tailSamples) {
+        if (!(outputBound <= threshold)) {
+            reset();
+            return false;
+        }
+
+        const bool wasIdle = idle;
+        idle = silentSamples >= tailSamples;
+        entered = idle && !wasIdle;
+        silentSamples = std::min(silentSamples + static_cast<int>(numSamples), tailSamples);
+        return idle;
+    }
+
+    // Whether the last update started an idle stretch
+    bool justEntered() const { return entered; }
+
+private:
+    int silentSamples = 0;
+    bool idle = false;
+    bool entered = false;
+};
@@ -0,0 +1,266 @@
+#pragma once
+
+#include <cmath>
+#include <vector>
+
+#include "SaturationSIMD.h"
+
+/**
+ * Per-sample gain ramp, geometric so it moves linearly in dB.
+ * The per-sample gains are generated a register at a time (lane k holds g * step^k,
+ * every iteration multiplies by step^width) and applied to each channel with one
+ * vectorized multiply, instead of a serial gain *= step chain per channel.
+ *
+ * A geometric ramp can't start or end at 0, those ends are taken at -120 dB
+ * and the ramp snaps to the exact target when it's done.
+ */
+class GainRamp {
+public:
+    void prepare(double newSampleRate, int maximumBlockSize) {
+        sampleRate = newSampleRate;
+        gains.resize(static_cast<size_t>(maximumBlockSize));
+        setRampTime(rampSeconds);
+    }
+
+    void setRampTime(double seconds) {
+        rampSeconds = seconds;
+        rampSamples = static_cast<int>(seconds * sampleRate + .5);
+    }
+
+    // Jumps straight to the gain
+    void reset(float gain) {
+        current = target = gain;
+        remaining = 0;
+    }
+
+    void setTarget(float gain) {
+        if (gain == target) return;
+
+        target = gain;
+        remaining = rampSamples;
+
+        if (remaining == 0) {
+            current = target;
+            return;
+        }
+
+        current = std::max(current, silence);
+        step = std::pow(static_cast<double>(std::max(target, silence)) / current, 1.0 / remaining);
+    }
+
+    bool isSmoothing() const { return remaining > 0; }
+
+    // Bounds every gain of the next block, the ramp only moves from current towards target
+    float getMaximumGain() const { return std::max(current, target); }
+
+    template <typename Sample>
+    void process(Sample* const* channels, size_t numChannels, size_t numSamples) {
+        // Blocks longer than announced in prepare are done in pieces
+        const size_t chunk = std::max(gains.size(), static_cast<size_t>(1));
+        for (size_t offset = 0; offset < numSamples; offset += chunk)
+            processChunk(channels, numChannels, offset, std::min(chunk, numSamples - offset));
+    }
+
+    /**
+     * Advances the ramp like process would and returns the gains instead of applying them,
+     * for code that folds the gain into its own pass. Returns nullptr for blocks longer
+     * than announced in prepare, which then have to go through process.
+     */
+    const float* nextGains(size_t numSamples) {
+        if (numSamples > gains.size()) return nullptr;
+
+        if (remaining == 0)
+            std::fill(gains.begin(), gains.begin() + static_cast<std::ptrdiff_t>(numSamples), current);
+        else
+            advanceRamp(numSamples);
+
+        return gains.data();
+    }
+
+private:
+    static constexpr float silence = 1e-6f;
+
+    double sampleRate = 44100, rampSeconds = .05;
+    int rampSamples = 0;
+
+    float current = 1, target = 1;
+    double step = 1;
+    int remaining = 0;
+
+    std::vector<float> gains;
+
+    template <typename Sample>
+    void processChunk(Sample* const* channels, size_t numChannels, size_t offset, size_t numSamples) {
+        // Before prepare there's no room for a ramp, jump to the target instead
+        if (gains.empty()) {
+            current = target;
+            remaining = 0;
+        }
+
+        if (remaining == 0) {
+            if (current != 1.0f)
+                for (size_t channel = 0; channel < numChannels; channel++)
+                    juce::FloatVectorOperations::multiply(channels[channel] + offset, static_cast<Sample>(current), static_cast<int>(numSamples));
+            return;
+        }
+
+        advanceRamp(numSamples);
+
+        for (size_t channel = 0; channel < numChannels; channel++)
+            applyGains(channels[channel] + offset, numSamples);
+    }
+
+    void applyGains(float* samples, size_t numSamples) const {
+        juce::FloatVectorOperations::multiply(samples, gains.data(), static_cast<int>(numSamples));
+    }
+
+    // There's no mixed precision multiply in FloatVectorOperations
+    void applyGains(double* samples, size_t numSamples) const {
+        for (size_t i = 0; i < numSamples; i++) samples[i] *= gains[i];
+    }
+
+    // Fills gains with the next numSamples, holding the target once the ramp ends
+    void advanceRamp(size_t numSamples) {
+        const size_t ramp = std::min(numSamples, static_cast<size_t>(remaining));
+        fillRamp(ramp);
+
+        remaining -= static_cast<int>(ramp);
+        current = remaining == 0 ? target : gains[ramp - 1];
+        std::fill(gains.begin() + static_cast<std::ptrdiff_t>(ramp), gains.begin() + static_cast<std::ptrdiff_t>(numSamples), current);
+    }
+
+    // gains[i] = current * step^(i + 1), the powers are taken in double so the end lands close to target
+    void fillRamp(size_t length) {
+        using Lanes = SIMDRegisterLanes<float>;
+
+        Lanes g;
+        double power = current;
+        for (size_t k = 0; k < Lanes::width; k++) g[k] = static_cast<float>(power *= step);
+        const Lanes stride(static_cast<float>(std::pow(step, static_cast<double>(Lanes::width))));
+
+        size_t i = 0;
+        for (; i + Lanes::width <= length; i += Lanes::width) {
+            g.store(gains.data() + i);
+            g = g * stride;
+        }
+
+        float last = i == 0 ? current : gains[i - 1];
+        for (; i < length; i++) gains[i] = last *= static_cast<float>(step);
+    }
+};
+
+/**
+ * Equal-power fade between the previous and the new curve, out = old * cos + new * sin.
+ * prepareBlock computes this block's two gain curves once, mix applies them per channel.
+ */
+class CurveCrossfade {
+public:
+    void prepare(size_t maximumBlockSize) {
+        fadeIn.resize(maximumBlockSize);
+        fadeOut.resize(maximumBlockSize);
+    }
+
+    void start(int lengthInSamples) {
+        length = std::max(lengthInSamples, 1);
+        position = 0;
+    }
+
+    void stop() { position = length = 0; }
+
+    bool isActive() const { return position < length; }
+
+    void prepareBlock(size_t numSamples) {
+        using Lanes = SIMDRegisterLanes<float>;
+
+        const float halfPiPerSample = juce::MathConstants<float>::halfPi / static_cast<float>(length);
+
+        Lanes offsets;
+        for (size_t k = 0; k < Lanes::width; k++) offsets[k] = static_cast<float>(k);
+
+        size_t i = 0;
+        for (; i + Lanes::width <= numSamples; i += Lanes::width) {
+            Lanes n = offsets + static_cast<float>(position + static_cast<int>(i));
+            Lanes angle = min(n * halfPiPerSample, Lanes(juce::MathConstants<float>::halfPi));
+            fastSin(angle).store(fadeIn.data() + i);
+            fastSin(Lanes(juce::MathConstants<float>::halfPi) - angle).store(fadeOut.data() + i);
+        }
+
+        for (; i < numSamples; i++) {
+            ScalarLanes<float> angle = std::min(static_cast<float>(position + static_cast<int>(i)) * halfPiPerSample,
+                                                juce::MathConstants<float>::halfPi);
+            fadeIn[i] = fastSin(angle)[0];
+            fadeOut[i] = fastSin(ScalarLanes<float>(juce::MathConstants<float>::halfPi) - angle)[0];
+        }
+    }
+
+    // current = current * fadeIn + previous * fadeOut, offset is where current starts in the block
+    template <typename Sample>
+    void mix(Sample* current, const Sample* previous, size_t offset, size_t numSamples) const {
+        const float* in = fadeIn.data() + offset;
+        const float* out = fadeOut.data() + offset;
+        for (size_t i = 0; i < numSamples; i++)
+            current[i] = current[i] * in[i] + previous[i] * out[i];
+    }
+
+    void advance(size_t numSamples) {
+        position = std::min(length, position + static_cast<int>(numSamples));
+    }
+
+private:
+    int length = 0, position = 0;
+    std::vector<float> fadeIn, fadeOut;
+};
+
+/**
+ * Takes the output down to silence while a new oversampling engine waits and back up
+ * once it runs, half a cosine each way. The engines share no filter history : cut over
+ * directly, the old one's ringing would stop dead and the new one start from zeros.
+ * After the swap the output stays down for a hold, until what the new engine makes of
+ * the input has come through its latency.
+ */
+class SwapFade {
+public:
+    static constexpr double fadeSeconds = .005;
+
+    void prepare(double sampleRate) {
+        length = std::max(1, juce::roundToInt(fadeSeconds * sampleRate));
+        position = length;
+        hold = 0;
+        down = false;
+    }
+
+    void setDown(bool shouldBeDown) { down = shouldBeDown; }
+
+    // Faded out, the engines can be swapped
+    bool isDown() const { return down && position == 0; }
+
+    // Right after the swap, holdSamples of silence before coming back up
+    void swapped(int holdSamples) {
+        down = false;
+        hold = std::max(holdSamples, 0);
+    }
+
+    // Straight to where it's heading, for blocks that come out silent anyway
+    void skip() {
+        position = down ? 0 : length;
+        hold = 0;
+    }
+
+    template <typename Sample>
+    void process(Sample* const* channels, size_t numChannels, size_t numSamples) {
+        for (size_t i = 0; i < numSamples; i++) {
+            if (!down && position == length) return;
+
+            if (down) position = std::max(position - 1, 0);
+            else if (hold > 0) hold--;
+            else position++;
+
+            const auto gain = static_cast<Sample>(.5 - .5 * std::cos(juce::MathConstants<double>::pi * position / length));
+            for (size_t channel = 0; channel < numChannels; channel++) channels[channel][i] *= gain;
+        }
+    }
+
+private:
+    int length = 1, position = 1, hold = 0;
+    bool down = false;
+};
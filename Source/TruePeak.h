@@ -0,0 +1,143 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include <JuceHeader.h>
+
+/**
+ * Output ceiling on inter-sample peaks, detected on the oversampled stream the curves
+ * already ran on instead of upsampling the output a second time.
+ *
+ * The processor records the peak of every base rate sample's oversampled samples
+ * (detect), then process turns them into a gain at the base rate, applied last :
+ * the gain each peak needs is held for the lookahead plus the decimator's delay (the
+ * oversampled stream runs ahead of the decimated output by that much), released
+ * exponentially, and averaged over the lookahead so the gain is down to what the peak
+ * needs by the time it leaves the delay line, with no step in it.
+ * The decimator rings over the stream's peaks, hard clipped noise comes out of the low
+ * latency IIR over 2x above them : the processor scales the peaks by the engine's
+ * worst case overshoot (OversamplerEngine::peakGain) along with the output gain.
+ * The output is delayed by the lookahead, which the processor adds to its latency.
+ */
+class TruePeakCeiling {
+public:
+    static constexpr double lookaheadSeconds = .001;
+    static constexpr double releaseSeconds = .05;
+    // Longest decimator delay the hold covers, anything longer is cut to it
+    static constexpr int maximumDetectionDelay = 4096;
+
+    void prepare(double sampleRate, size_t numChannels, int maximumBlockSize) {
+        lookahead = std::max(1, juce::roundToInt(lookaheadSeconds * sampleRate));
+        release = static_cast<float>(1 - std::exp(-1 / (releaseSeconds * sampleRate)));
+
+        delay.assign(numChannels, std::vector<double>(static_cast<size_t>(lookahead), 0.0));
+        average.assign(static_cast<size_t>(lookahead), 1.0f);
+        window.assign(static_cast<size_t>(lookahead + maximumDetectionDelay + 2), Entry());
+        peaks.assign(static_cast<size_t>(maximumBlockSize), 0.0f);
+        reset();
+    }
+
+    void reset() {
+        for (auto& line : delay) std::fill(line.begin(), line.end(), 0.0);
+        std::fill(average.begin(), average.end(), 1.0f);
+        position = 0;
+        sum = lookahead;
+        envelope = 1;
+        front = back = 0;
+        time = 0;
+    }
+
+    int getLookahead() const { return lookahead; }
+
+    /**
+     * Clears the peaks for a block. A block longer than announced in prepare gets nullptr
+     * and nothing to detect with, process then only delays it.
+     */
+    float* beginBlock(size_t numSamples) {
+        detected = numSamples <= peaks.size() ? numSamples : 0;
+        std::fill(peaks.begin(), peaks.begin() + static_cast<std::ptrdiff_t>(detected), 0.0f);
+        return detected > 0 ? peaks.data() : nullptr;
+    }
+
+    /**
+     * Oversampled samples starting offset samples into the block, offset and count
+     * whole multiples of factor : each group of factor samples raises its base rate
+     * sample's peak.
+     */
+    template <typename Sample>
+    static void detect(float* blockPeaks, const Sample* samples, size_t offset, size_t count, size_t factor) {
+        for (size_t i = 0; i < count; i += factor) {
+            const auto range = juce::FloatVectorOperations::findMinAndMax(samples + i, static_cast<int>(factor));
+            float& peak = blockPeaks[(offset + i) / factor];
+            peak = std::max({ peak, static_cast<float>(-range.getStart()), static_cast<float>(range.getEnd()) });
+        }
+    }
+
+    // Base rate samples, for stretches that skipped the oversampler
+    template <typename Sample>
+    static void detectSamples(float* blockPeaks, const Sample* samples, size_t numSamples) {
+        for (size_t i = 0; i < numSamples; i++) blockPeaks[i] = std::max(blockPeaks[i], static_cast<float>(std::abs(samples[i])));
+    }
+
+    /**
+     * In place over the block's output, gain bounds what took the stream from detection
+     * to here. detectionDelay is the decimator's delay in base rate samples.
+     */
+    template <typename Sample>
+    void process(Sample* const* channels, size_t numChannels, size_t numSamples, float ceiling, float gain, int detectionDelay) {
+        const int hold = lookahead + std::clamp(detectionDelay, 0, maximumDetectionDelay) + 1;
+        const size_t capacity = window.size();
+        numChannels = std::min(numChannels, delay.size());
+
+        for (size_t i = 0; i < numSamples; i++) {
+            const float peak = i < detected ? peaks[i] * gain : 0.0f;
+            const float required = peak > ceiling ? ceiling / peak : 1.0f;
+
+            // Minimum over the last hold samples, a queue of ever larger gains
+            while (back != front && window[(back + capacity - 1) % capacity].gain >= required) back = (back + capacity - 1) % capacity;
+            window[back] = { required, time };
+            back = (back + 1) % capacity;
+            while (time - window[front].time >= hold) front = (front + 1) % capacity;
+            const float held = window[front].gain;
+            time++;
+
+            envelope = held < envelope ? held : envelope + (held - envelope) * release;
+
+            sum += envelope - average[position];
+            average[position] = envelope;
+            const float smoothed = static_cast<float>(sum / lookahead);
+
+            for (size_t channel = 0; channel < numChannels; channel++) {
+                const double delayed = delay[channel][position];
+                delay[channel][position] = channels[channel][i];
+                channels[channel][i] = static_cast<Sample>(delayed * smoothed);
+            }
+
+            position = position + 1 == static_cast<size_t>(lookahead) ? 0 : position + 1;
+        }
+    }
+
+private:
+    struct Entry {
+        float gain = 1;
+        juce::int64 time = 0;
+    };
+
+    int lookahead = 1;
+    float release = 0;
+
+    // Double, so double blocks come out of it as they went in
+    std::vector<std::vector<double>> delay;
+    std::vector<float> average;
+    size_t position = 0;
+    double sum = 1;
+    float envelope = 1;
+
+    std::vector<Entry> window;
+    size_t front = 0, back = 0;
+    juce::int64 time = 0;
+
+    std::vector<float> peaks;
+    size_t detected = 0;
+};
@@ -0,0 +1,677 @@
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <type_traits>
+#include <vector>
+#include <JuceHeader.h>
+
+#include "../../../Source/APCommon.h"
+#include "../../../Source/PluginProcessor.h"
+
+/**
+ * Accuracy checks for the optimized kernels and golden renders of processBlock, the
+ * gate for accepting a faster approximation. Exits with 1 when any check fails.
+ *
+ * kernel/ : every curve's SIMD and table kernels against its reference in Saturation.h,
+ * swept over the domain the headers document their error for (a dense grid around 0,
+ * log spaced magnitudes, the +-1e4 branches, fold's wraparound points) with a max abs
+ * error bound, or a ULP bound for the kernels that are meant to be exact. Past the
+ * domain the output only has to stay finite and within the curve's range.
+ * The ADAA kernels are checked on ramps and jumps against the mean of the reference
+ * curve over each step (first order) or under the hat between the last three inputs
+ * (second order), integrated numerically.
+ *
+ * golden/ : processBlock renders of generated test signals under a few parameter sets,
+ * nulled against the WAV files in the golden folder. Every set is rendered a second time
+ * in double precision and nulled against the same file. --write-golden records them after
+ * a change in output that is meant to happen, along with the build they came from.
+ *
+ * truepeak/ : renders with the true peak ceiling on, hard driven, upsampled 4x the way
+ * BS.1770 measures true peak. The output's true peak has to stay under the ceiling.
+ */
+
+namespace {
+
+struct Options {
+    juce::String filter;
+    juce::File goldenFolder;
+    bool writeGolden = false;
+    // Peak of render minus golden, dBFS
+    double nullThreshold = -100;
+    /**
+     * Same for the double render. Double blocks take the reference curves where float
+     * ones take the fitted kernels, a few 1e-6 apart at most, see curveBounds.
+     */
+    double doubleNullThreshold = -90;
+};
+
+struct Bound {
+    double maxAbs;
+    // A sample also passes within this many ulps of the reference, for the exact kernels
+    int maxUlp = 0;
+};
+
+struct CurveBounds {
+    // |x| the bounds hold for
+    float domain;
+    Bound simd, tableLinear, tableCubic, adaa1, adaa2;
+    // Largest |f(x)| the curve reaches
+    float range = 1;
+};
+
+/**
+ * Per curve, in registry order : the figures documented in SaturationSIMD.h and
+ * SaturationTable.h with some headroom, so a regression fails but a different libm doesn't.
+ * Second order ADAA divides the antiderivative tables' error by dx^2, on the slow ramps
+ * past +-7 that comes to a few 1e-4 for the tabulated curves. The ADAA figures also
+ * carry the numerical integration's own error near the singular slopes of sqrt and cube.
+ */
+const CurveBounds curveBounds[] = {
+    //                         simd       table linear  table cubic  adaa1      adaa2
+    /* tanh         */ { 1e4f, { 5e-7 },  { 6e-7 },     { 5e-7 },    { 3e-7 },  { 5e-4 } },
+    /* sine         */ { 1e4f, { 3e-7 },  { 1.2e-6 },   { 1.2e-6 },  { 1e-7 },  { 1e-7 } },
+    /* hard         */ { 1e4f, { 4e-7 },  { 1.5e-6 },   { 7e-7 },    { 1.5e-6 }, { 5e-4 } },
+    /* log          */ { 1e4f, { 3e-7 },  { 1e-6 },     { 7e-7 },    { 2e-6 },  { 5e-4 } },
+    /* sqrt         */ { 1e4f, { 4e-7 },  { 1.6e-6 },   { 7e-7 },    { 6e-6 },  { 5e-4 } },
+    /* cube         */ { 1e4f, { 4e-6 },  { 4.5e-6 },   { 4.5e-6 },  { 4e-5 },  { 6e-6 } },
+    /* fold         */ { 5.3e8f, { 0, 0 }, { 0, 0 },    { 0, 0 },    { 1.5e-6 }, { 3e-7 }, threshold },
+    /* squaredSine  */ { 64,   { 3e-7 },  { 1.2e-6 },   { 1.3e-6 },  { 8e-6 },  { 6e-6 } },
+    /* asym         */ { 1e4f, { 4e-7 },  { 1.5e-6 },   { 7e-7 },    { 1.5e-6 }, { 5e-4 } },
+};
+
+static_assert(std::size(curveBounds) == numCurves, "every curve needs its bounds");
+
+struct Check {
+    juce::String name;
+    double maxAbs = 0;
+    juce::int64 maxUlp = 0;
+    float worstInput = 0;
+    bool passed = true;
+};
+
+bool isSelected(const Options& options, const juce::String& name) {
+    return options.filter.isEmpty() || name.contains(options.filter);
+}
+
+// Distance in representable floats, 0 and -0 are the same
+juce::int64 ulpDistance(float a, float b) {
+    auto ordered = [] (float x) {
+        juce::int32 bits;
+        std::memcpy(&bits, &x, sizeof(bits));
+        return bits < 0 ? static_cast<juce::int64>(std::numeric_limits<juce::int32>::min()) - bits : static_cast<juce::int64>(bits);
+    };
+    return std::abs(ordered(a) - ordered(b));
+}
+
+void compare(Check& check, const Bound& bound, float input, float actual, double expected) {
+    const double error = std::abs(static_cast<double>(actual) - expected);
+    const juce::int64 ulps = ulpDistance(actual, static_cast<float>(expected));
+
+    if (!std::isfinite(actual) || (error > bound.maxAbs && ulps > bound.maxUlp)) check.passed = false;
+    if (error > check.maxAbs || !std::isfinite(actual)) {
+        check.maxAbs = std::isfinite(actual) ? error : HUGE_VAL;
+        check.worstInput = input;
+    }
+    check.maxUlp = std::max(check.maxUlp, ulps);
+}
+
+/**
+ * Inputs within the domain : a dense grid over -4..4 where the curves bend, log spaced
+ * magnitudes up to the domain, and the points each side of the +-1e4 branches and of
+ * every fold period boundary k * 1.8.
+ */
+std::vector<float> makeSweep(float domain) {
+    std::vector<float> inputs;
+
+    for (int i = -40000; i <= 40000; i++) inputs.push_back(static_cast<float>(i) * 1e-4f);
+
+    for (int i = 0; i <= 20000; i++) {
+        const float magnitude = static_cast<float>(std::pow(10.0, -7 + (std::log10(domain) + 7) * i / 20000));
+        inputs.push_back(magnitude);
+        inputs.push_back(-magnitude);
+    }
+
+    auto around = [&inputs, domain] (float x) {
+        float below = x, above = x;
+        for (int i = 0; i < 3; i++) {
+            below = std::nextafter(below, -FLT_MAX);
+            above = std::nextafter(above, FLT_MAX);
+            for (float point : { below, x, above })
+                if (std::abs(point) <= domain) inputs.push_back(point);
+        }
+    };
+
+    for (float edge : { 1e4f, -1e4f, domain, -domain, FLT_MIN, -FLT_MIN }) around(edge);
+    for (double k = 1; k * 2 * threshold < domain; k = std::ceil(k * 1.05)) {
+        around(static_cast<float>(k * 2 * threshold));
+        around(static_cast<float>(-k * 2 * threshold));
+        around(static_cast<float>((k + .5) * 2 * threshold));
+    }
+
+    return inputs;
+}
+
+// Past the domain, up to the largest float
+std::vector<float> makeExtremes(float domain) {
+    std::vector<float> inputs;
+    for (float magnitude = domain * 1.5f; magnitude < FLT_MAX / 10; magnitude *= 10) {
+        inputs.push_back(magnitude);
+        inputs.push_back(-magnitude);
+    }
+    for (float magnitude : { FLT_MAX, 1e18f, 4194304.0f, 536870912.0f }) {
+        inputs.push_back(magnitude);
+        inputs.push_back(-magnitude);
+    }
+    return inputs;
+}
+
+template <float (*Func)(float)>
+void checkKernels(const Options& options, const char* name, const CurveBounds& bounds,
+                  const SaturationTables& tables, std::vector<Check>& checks) {
+    const std::vector<float> sweep = makeSweep(bounds.domain);
+    const std::vector<float> extremes = makeExtremes(bounds.domain);
+
+    const std::pair<const char*, std::pair<Bound, std::function<void(float*, size_t)>>> kernels[] = {
+        { "simd", { bounds.simd, [] (float* samples, size_t length) { performSaturationSIMD<Func>(samples, length); } } },
+        { "table linear", { bounds.tableLinear, [&tables] (float* samples, size_t length) {
+            performSaturationTable<Func, TableInterpolation::linear>(tables, samples, length); } } },
+        { "table cubic", { bounds.tableCubic, [&tables] (float* samples, size_t length) {
+            performSaturationTable<Func, TableInterpolation::cubic>(tables, samples, length); } } },
+    };
+
+    for (const auto& kernel : kernels) {
+        const juce::String checkName = juce::String("kernel/") + name + "/" + kernel.first;
+        if (!isSelected(options, checkName)) continue;
+
+        Check check { checkName };
+        std::vector<float> samples(sweep);
+        kernel.second.second(samples.data(), samples.size());
+        for (size_t i = 0; i < sweep.size(); i++)
+            compare(check, kernel.second.first, sweep[i], samples[i], Func(sweep[i]));
+
+        // Bounded and finite is all the headers promise out there
+        samples = extremes;
+        kernel.second.second(samples.data(), samples.size());
+        for (size_t i = 0; i < extremes.size(); i++)
+            if (!(std::abs(samples[i]) <= bounds.range + 1e-5f)) {
+                check.passed = false;
+                check.worstInput = extremes[i];
+            }
+
+        checks.push_back(check);
+    }
+}
+
+// Simpson intervals over a width, 1 / 1024 apart at most so squaredSine's faster wiggles and fold's corners stay resolved
+int intervalsFor(double width) {
+    return 2 * std::max(128, static_cast<int>(std::ceil(width * 512)));
+}
+
+// Mean of Func over [a, b]
+template <float (*Func)(float)>
+double meanOver(double a, double b) {
+    if (a == b) return Func(static_cast<float>(a));
+
+    const int intervals = intervalsFor(b - a);
+    const double h = (b - a) / intervals;
+    double sum = Func(static_cast<float>(a)) + Func(static_cast<float>(b));
+    for (int i = 1; i < intervals; i++)
+        sum += (i % 2 == 0 ? 2 : 4) * static_cast<double>(Func(static_cast<float>(a + i * h)));
+    return sum * h / 3 / (b - a);
+}
+
+// Mean of Func under the hat rising from x2 to x1 and falling to x0
+template <float (*Func)(float)>
+double hatMean(double x2, double x1, double x0) {
+    const double lo = std::min(x2, x0), hi = std::max(x2, x0);
+    const double peak = std::clamp(x1, lo, hi);
+    if (hi - lo <= 0) return Func(static_cast<float>(lo));
+
+    const int intervals = intervalsFor(hi - lo);
+    double sum = 0, weight = 0;
+    for (const auto& [from, to] : { std::pair<double, double>(lo, peak), std::pair<double, double>(peak, hi) }) {
+        if (to <= from) continue;
+        const double h = (to - from) / intervals;
+        for (int i = 0; i <= intervals; i++) {
+            const double t = from + i * h;
+            const double hat = t <= peak ? (t - lo) / (peak - lo) : (hi - t) / (hi - peak);
+            const double w = (i == 0 || i == intervals ? 1 : i % 2 == 0 ? 2 : 4) * h / 3 * hat;
+            sum += w * Func(static_cast<float>(t));
+            weight += w;
+        }
+    }
+    return sum / weight;
+}
+
+/**
+ * A slow ramp over -8..8, where the ill conditioned fallback stays out of the way, then
+ * random jumps within +-16. The second order check only uses inputs with x1
+ * between x2 and x0, the hat degenerates otherwise.
+ */
+template <float (*Func)(float)>
+void checkADAA(const Options& options, const char* name, const CurveBounds& bounds, std::vector<Check>& checks) {
+    const AntiderivativeTables& antiderivatives = AntiderivativeTables::getInstance();
+
+    std::vector<float> inputs;
+    for (int i = -800; i <= 800; i++) inputs.push_back(static_cast<float>(i) * 1e-2f);
+    juce::Random random(7);
+    const float span = std::min(bounds.domain, 16.0f);
+    for (int i = 0; i < 2000; i++) inputs.push_back((random.nextFloat() * 2 - 1) * span);
+
+    for (int order = 1; order <= 2; order++) {
+        const juce::String checkName = juce::String("kernel/") + name + "/adaa" + juce::String(order);
+        if (!isSelected(options, checkName)) continue;
+
+        Check check { checkName };
+        ADAAChannelState state;
+        std::vector<float> samples(inputs);
+        if (order == 1)
+            performSaturationADAA1<Func>(antiderivatives, state, samples.data(), samples.size());
+        else
+            performSaturationADAA2<Func>(antiderivatives, state, samples.data(), samples.size());
+
+        for (size_t i = 2; i < inputs.size(); i++) {
+            const double x0 = inputs[i], x1 = inputs[i - 1], x2 = inputs[i - 2];
+            if (isIllConditioned(x0 - x1, x0) || isIllConditioned(x0 - x2, x0)) continue;
+
+            if (order == 1)
+                compare(check, bounds.adaa1, inputs[i], samples[i], meanOver<Func>(std::min(x0, x1), std::max(x0, x1)));
+            else if ((x1 - x2) * (x0 - x1) > 0)
+                compare(check, bounds.adaa2, inputs[i], samples[i], hatMean<Func>(x2, x1, x0));
+        }
+
+        checks.push_back(check);
+    }
+}
+
+template <int index = 0>
+void checkCurves(const Options& options, const SaturationTables& tables, std::vector<Check>& checks) {
+    if constexpr (index < numCurves) {
+        checkKernels<curveRegistry[index].function>(options, curveRegistry[index].name, curveBounds[index], tables, checks);
+        checkADAA<curveRegistry[index].function>(options, curveRegistry[index].name, curveBounds[index], checks);
+        checkCurves<index + 1>(options, tables, checks);
+    }
+}
+
+
+constexpr double goldenSampleRate = 44100;
+constexpr int goldenBlockSize = 512;
+constexpr int goldenChannels = 2;
+
+struct GoldenCase {
+    const char* name;
+    std::vector<std::pair<const char*, float>> parameters;
+};
+
+// Parameter values in their own units, like BatchRenderer's --set
+const std::vector<GoldenCase> goldenCases = {
+    { "default", {} },
+    { "tanh driven", { { "inGain", 12 } } },
+    { "fold 4x iir", { { "selection", 6 }, { "inGain", 12 }, { "oversampling", 2 }, { "filter", 1 } } },
+    // The low latency engine runs gains, filters and curve fused
+    { "tanh low latency", { { "inGain", 12 }, { "filter", 2 } } },
+    { "log table cubic", { { "selection", 3 }, { "inGain", 24 }, { "shaper", 2 } } },
+    { "hard adaa2", { { "selection", 2 }, { "inGain", 12 }, { "adaa", 2 }, { "oversampling", 0 } } },
+    // The sweep stays under hard's knee at the base rate, noise and impulses fade the oversampler in
+    { "hard adaptive", { { "selection", 2 }, { "adaptive", 1 } } },
+    { "asym dc filter", { { "selection", 8 }, { "inGain", 12 }, { "dcFilter", 2 } } },
+    { "multiband", { { "multiband", 1 }, { "lowCurve", 1 }, { "highCurve", 2 }, { "lowDrive", 6 }, { "highDrive", 9 } } },
+    { "diode clipper", { { "model", 1 }, { "inGain", 6 } } },
+    { "tape hysteresis", { { "model", 2 }, { "inGain", 6 } } },
+    { "true peak", { { "inGain", 18 }, { "truePeak", 1 }, { "ceiling", -1 } } },
+};
+
+/**
+ * Two seconds of stereo : a logarithmic sine sweep 20 Hz - 20 kHz at -6 dBFS on the
+ * left, on the right a burst of noise, an impulse train and silence long enough for
+ * the idle detection to kick in. Seeded, the same on every machine.
+ */
+juce::AudioBuffer<float> makeTestSignal() {
+    const int length = static_cast<int>(goldenSampleRate * 2);
+    juce::AudioBuffer<float> signal(goldenChannels, length);
+    signal.clear();
+
+    double phase = 0;
+    for (int i = 0; i < length; i++) {
+        const double frequency = 20 * std::pow(1000.0, static_cast<double>(i) / length);
+        phase += juce::MathConstants<double>::twoPi * frequency / goldenSampleRate;
+        signal.setSample(0, i, static_cast<float>(.5 * std::sin(phase)));
+    }
+
+    juce::Random random(11);
+    const int quarter = length / 4;
+    for (int i = 0; i < quarter; i++) signal.setSample(1, i, random.nextFloat() * 2 - 1);
+    for (int i = quarter; i < 2 * quarter; i += 441) signal.setSample(1, i, 1);
+
+    return signal;
+}
+
+// Processed at Sample's precision, handed back in float either way
+template <typename Sample>
+juce::AudioBuffer<float> render(const GoldenCase& golden, const juce::AudioBuffer<float>& input) {
+    APSatur processor;
+    for (const auto& [id, value] : golden.parameters)
+        if (auto* parameter = processor.apvts.getParameter(id))
+            parameter->setValueNotifyingHost(parameter->convertTo0to1(value));
+
+    processor.setProcessingPrecision(std::is_same_v<Sample, double> ? juce::AudioProcessor::doublePrecision
+                                                                    : juce::AudioProcessor::singlePrecision);
+    processor.setPlayConfigDetails(goldenChannels, goldenChannels, goldenSampleRate, goldenBlockSize);
+    processor.setNonRealtime(true);
+    processor.prepareToPlay(goldenSampleRate, goldenBlockSize);
+
+    juce::AudioBuffer<Sample> output;
+    output.makeCopyOf(input);
+    juce::MidiBuffer midi;
+    for (int offset = 0; offset < output.getNumSamples(); offset += goldenBlockSize) {
+        const int length = std::min(goldenBlockSize, output.getNumSamples() - offset);
+        juce::AudioBuffer<Sample> block(output.getArrayOfWritePointers(), goldenChannels, offset, length);
+        processor.processBlock(block, midi);
+    }
+
+    processor.releaseResources();
+
+    juce::AudioBuffer<float> rendered;
+    rendered.makeCopyOf(output);
+    return rendered;
+}
+
+/**
+ * Tools/Accuracy/Golden whatever the tool is launched from : next to this file when the
+ * compiler saw an absolute path, otherwise found walking up from the executable, which
+ * every exporter builds somewhere under Tools/Accuracy/Builds.
+ */
+juce::File findGoldenFolder() {
+    const juce::String source(__FILE__);
+    if (juce::File::isAbsolutePath(source) && juce::File(source).existsAsFile())
+        return juce::File(source).getParentDirectory().getSiblingFile("Golden");
+
+    juce::File folder = juce::File::getSpecialLocation(juce::File::currentExecutableFile);
+    while (folder != folder.getParentDirectory()) {
+        folder = folder.getParentDirectory();
+        if (folder.getChildFile("Accuracy.jucer").existsAsFile()) return folder.getChildFile("Golden");
+    }
+
+    return juce::File::getCurrentWorkingDirectory().getChildFile("Golden");
+}
+
+juce::File goldenFile(const Options& options, const GoldenCase& golden) {
+    return options.goldenFolder.getChildFile(juce::String(golden.name).replaceCharacter(' ', '-') + ".wav");
+}
+
+/**
+ * Compiler, configuration, JUCE, OS and instruction set, written next to the WAVs. Another
+ * libm or SIMD width can move a render past the threshold, a failing null on a different
+ * build than the recorded one may be the build rather than the code.
+ */
+juce::String describeBuild() {
+    juce::StringArray lines;
+
+   #if defined(__clang__)
+    lines.add("compiler: Clang " __clang_version__);
+   #elif defined(__GNUC__)
+    lines.add("compiler: GCC " __VERSION__);
+   #elif defined(_MSC_VER)
+    lines.add("compiler: MSVC " + juce::String(_MSC_FULL_VER));
+   #else
+    lines.add("compiler: unknown");
+   #endif
+
+   #if JUCE_DEBUG
+    lines.add("configuration: debug");
+   #else
+    lines.add("configuration: release");
+   #endif
+
+    juce::StringArray instructions;
+   #if defined(__AVX2__)
+    instructions.add("AVX2");
+   #endif
+   #if defined(__AVX__)
+    instructions.add("AVX");
+   #endif
+   #if defined(__SSE4_1__)
+    instructions.add("SSE4.1");
+   #endif
+   #if defined(__SSE2__) || defined(_M_X64)
+    instructions.add("SSE2");
+   #endif
+   #if defined(__ARM_NEON) || defined(_M_ARM64)
+    instructions.add("NEON");
+   #endif
+   #if defined(__FMA__)
+    instructions.add("FMA");
+   #endif
+
+    lines.add("juce: " + juce::SystemStats::getJUCEVersion());
+    lines.add("os: " + juce::SystemStats::getOperatingSystemName());
+    lines.add("cpu: " + juce::SystemStats::getCpuModel());
+    lines.add("instructions: " + (instructions.isEmpty() ? juce::String("none") : instructions.joinIntoString(" ")));
+    lines.add("simd: " + juce::String(static_cast<int>(SIMDRegisterLanes<float>::width)) + " float lanes");
+
+    return lines.joinIntoString("\n") + "\n";
+}
+
+juce::File goldenBuildFile(const Options& options) {
+    return options.goldenFolder.getChildFile("build.txt");
+}
+
+bool writeWav(const juce::File& file, const juce::AudioBuffer<float>& buffer) {
+    file.deleteFile();
+    std::unique_ptr<juce::FileOutputStream> stream(file.createOutputStream());
+    if (stream == nullptr) return false;
+
+    juce::WavAudioFormat wav;
+    std::unique_ptr<juce::AudioFormatWriter> writer(wav.createWriterFor(stream.get(), goldenSampleRate,
+                                                                        static_cast<unsigned>(buffer.getNumChannels()),
+                                                                        32, {}, 0));
+    if (writer == nullptr) return false;
+    stream.release();
+    return writer->writeFromAudioSampleBuffer(buffer, 0, buffer.getNumSamples());
+}
+
+bool readWav(const juce::File& file, juce::AudioBuffer<float>& buffer) {
+    juce::WavAudioFormat wav;
+    std::unique_ptr<juce::AudioFormatReader> reader(wav.createReaderFor(file.createInputStream().release(), true));
+    if (reader == nullptr) return false;
+
+    buffer.setSize(static_cast<int>(reader->numChannels), static_cast<int>(reader->lengthInSamples));
+    return reader->read(&buffer, 0, buffer.getNumSamples(), 0, true, true);
+}
+
+// Peak residual and where it is, passed when it stays under threshold in dBFS
+Check nullAgainst(const juce::String& name, const juce::AudioBuffer<float>& output,
+                  const juce::AudioBuffer<float>& reference, double threshold) {
+    Check check { name };
+    for (int channel = 0; channel < output.getNumChannels(); channel++)
+        for (int i = 0; i < output.getNumSamples(); i++) {
+            const double residual = std::abs(static_cast<double>(output.getSample(channel, i)) - reference.getSample(channel, i));
+            if (!(residual <= check.maxAbs)) {
+                check.maxAbs = std::isnan(residual) ? HUGE_VAL : residual;
+                check.worstInput = static_cast<float>(i);
+            }
+        }
+
+    check.passed = juce::Decibels::gainToDecibels(check.maxAbs, -400.0) <= threshold;
+    return check;
+}
+
+void checkGolden(const Options& options, std::vector<Check>& checks) {
+    const juce::AudioBuffer<float> input = makeTestSignal();
+    const juce::File buildFile = goldenBuildFile(options);
+    const juce::String build = describeBuild();
+    bool rendered = false;
+
+    if (options.writeGolden) {
+        options.goldenFolder.createDirectory();
+    } else if (buildFile.existsAsFile() && buildFile.loadFileAsString() != build) {
+        std::cout << "golden renders recorded on\n" << buildFile.loadFileAsString() << "this is\n" << build << "\n";
+    }
+
+    for (const GoldenCase& golden : goldenCases) {
+        const juce::String checkName = juce::String("golden/") + golden.name;
+        if (!isSelected(options, checkName)) continue;
+
+        const juce::AudioBuffer<float> output = render<float>(golden, input);
+        const juce::File file = goldenFile(options, golden);
+        rendered = true;
+
+        // Freshly recorded, the double render still has to null against it
+        juce::AudioBuffer<float> reference;
+        if (options.writeGolden) {
+            Check check { checkName };
+            check.passed = writeWav(file, output);
+            checks.push_back(check);
+            reference.makeCopyOf(output);
+        } else if (!readWav(file, reference) || reference.getNumChannels() != output.getNumChannels()
+                   || reference.getNumSamples() != output.getNumSamples()) {
+            std::cout << checkName << " : no usable " << file.getFullPathName() << ", record it with --write-golden\n";
+            Check check { checkName };
+            check.passed = false;
+            checks.push_back(check);
+            continue;
+        } else {
+            checks.push_back(nullAgainst(checkName, output, reference, options.nullThreshold));
+        }
+
+        checks.push_back(nullAgainst(checkName + " double", render<double>(golden, input), reference, options.doubleNullThreshold));
+    }
+
+    if (!options.writeGolden || !rendered) return;
+
+    if (buildFile.replaceWithText(build)) {
+        std::cout << "recorded the build in " << buildFile.getFullPathName() << "\n";
+    } else {
+        std::cout << "couldn't write " << buildFile.getFullPathName() << "\n";
+        Check check { "golden/build" };
+        check.passed = false;
+        checks.push_back(check);
+    }
+}
+
+/**
+ * Largest magnitude of the buffer and of its 4x upsampled version, a Kaiser windowed sinc
+ * (beta 8) with 48 taps per phase. BS.1770 gets by with 12, these stay within 0.002 dB
+ * of flat up to 19 kHz at 44.1 kHz.
+ */
+double measureTruePeak(const juce::AudioBuffer<float>& buffer) {
+    constexpr int factor = 4, taps = 48, length = factor * taps;
+
+    auto bessel = [] (double x) {
+        double sum = 1, term = 1;
+        for (int k = 1; k < 40; k++) {
+            term *= (x / (2 * k)) * (x / (2 * k));
+            sum += term;
+        }
+        return sum;
+    };
+
+    // Centred between taps, every phase falls between two input samples
+    std::vector<double> kernel(length);
+    for (int k = 0; k < length; k++) {
+        const double centred = k - (length - 1) / 2.0;
+        const double t = juce::MathConstants<double>::pi * centred / factor;
+        const double window = bessel(8 * std::sqrt(1 - std::pow(centred / ((length - 1) / 2.0), 2))) / bessel(8);
+        kernel[static_cast<size_t>(k)] = std::sin(t) / t * window;
+    }
+
+    double peak = 0;
+    for (int channel = 0; channel < buffer.getNumChannels(); channel++) {
+        const float* samples = buffer.getReadPointer(channel);
+        for (int i = 0; i < buffer.getNumSamples(); i++) {
+            peak = std::max(peak, static_cast<double>(std::abs(samples[i])));
+
+            for (int phase = 0; phase < factor; phase++) {
+                double sum = 0;
+                for (int tap = 0; tap < taps && tap <= i; tap++)
+                    sum += kernel[static_cast<size_t>(tap * factor + phase)] * samples[i - tap];
+                peak = std::max(peak, std::abs(sum));
+            }
+        }
+    }
+
+    return peak;
+}
+
+constexpr float truePeakCeiling = -1;
+// The measurement's own passband ripple
+constexpr double truePeakTolerance = .01;
+
+// Driven 36 dB past clipping, through the linear phase FIR and the low latency IIR, which overshoots most
+const std::vector<GoldenCase> truePeakCases = {
+    { "hard fir", { { "selection", 2 }, { "inGain", 36 }, { "truePeak", 1 }, { "ceiling", truePeakCeiling } } },
+    { "tanh fir", { { "selection", 0 }, { "inGain", 36 }, { "truePeak", 1 }, { "ceiling", truePeakCeiling } } },
+    { "hard iir low latency", { { "selection", 2 }, { "inGain", 36 }, { "filter", 2 }, { "truePeak", 1 }, { "ceiling", truePeakCeiling } } },
+    { "tanh iir low latency", { { "selection", 0 }, { "inGain", 36 }, { "filter", 2 }, { "truePeak", 1 }, { "ceiling", truePeakCeiling } } },
+};
+
+void checkTruePeak(const Options& options, std::vector<Check>& checks) {
+    const juce::AudioBuffer<float> input = makeTestSignal();
+
+    for (const GoldenCase& truePeakCase : truePeakCases) {
+        const juce::String checkName = juce::String("truepeak/") + truePeakCase.name;
+        if (!isSelected(options, checkName)) continue;
+
+        Check check { checkName };
+        check.maxAbs = measureTruePeak(render<float>(truePeakCase, input));
+        check.passed = juce::Decibels::gainToDecibels(check.maxAbs, -400.0) <= truePeakCeiling + truePeakTolerance;
+        checks.push_back(check);
+    }
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+    Options options;
+    options.goldenFolder = findGoldenFolder();
+
+    for (int i = 1; i < argc; i++) {
+        const juce::String argument(argv[i]);
+        const bool hasValue = i + 1 < argc;
+
+        if (argument == "--filter" && hasValue) {
+            options.filter = argv[++i];
+        } else if (argument == "--golden" && hasValue) {
+            options.goldenFolder = juce::File::getCurrentWorkingDirectory().getChildFile(argv[++i]);
+        } else if (argument == "--write-golden") {
+            options.writeGolden = true;
+        } else if (argument == "--threshold" && hasValue) {
+            options.nullThreshold = juce::String(argv[++i]).getDoubleValue();
+        } else if (argument == "--double-threshold" && hasValue) {
+            options.doubleNullThreshold = juce::String(argv[++i]).getDoubleValue();
+        } else {
+            std::cout << "Usage: Accuracy [--filter <substring>] [--golden <folder>] [--write-golden]\n"
+                         "                [--threshold <null test dBFS>] [--double-threshold <null test dBFS>]\n";
+            return argument == "--help" ? 0 : 1;
+        }
+    }
+
+    std::vector<Check> checks;
+
+    static SaturationTables tables;
+    tables.build();
+    checkCurves(options, tables, checks);
+    checkGolden(options, checks);
+    checkTruePeak(options, checks);
+
+    bool passed = true;
+    for (const Check& check : checks) {
+        passed = passed && check.passed;
+        std::cout << (check.passed ? "pass  " : "FAIL  ") << check.name.paddedRight(' ', 32)
+                  << (check.name.startsWith("golden/")
+                          ? "null " + juce::String(juce::Decibels::gainToDecibels(check.maxAbs, -400.0), 1) + " dBFS at sample "
+                                + juce::String(static_cast<int>(check.worstInput))
+                          : check.name.startsWith("truepeak/")
+                          ? "true peak " + juce::String(juce::Decibels::gainToDecibels(check.maxAbs, -400.0), 2) + " dBTP"
+                          : "max abs " + juce::String(check.maxAbs, 3, true) + "  max ulp " + juce::String(check.maxUlp)
+                                + "  worst x " + juce::String(check.worstInput))
+                  << "\n";
+    }
+
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,235 @@
+#include <atomic>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <JuceHeader.h>
+
+#include "../../../Source/APCommon.h"
+#include "../../../Source/PluginProcessor.h"
+
+/**
+ * Offline renderer : runs APSatur over audio files without a host.
+ *
+ * Every worker thread owns one processor and pulls the next file from a shared index.
+ * Files are read and written in large chunks and fed to processBlock in host sized
+ * blocks, the reported latency is trimmed so the output lines up with the input.
+ */
+
+namespace {
+
+struct Settings {
+    juce::File outputDirectory;
+    juce::File preset;
+    juce::StringPairArray parameters;
+    juce::String format;
+    int blockSize = 512;
+    int jobs = 0;
+};
+
+constexpr int chunkSize = 1 << 16;
+
+std::mutex outputLock;
+
+void printLine(const juce::String& line, bool error = false) {
+    std::lock_guard<std::mutex> lock(outputLock);
+    (error ? std::cerr : std::cout) << line << std::endl;
+}
+
+void printUsage() {
+    std::cout << "Usage: BatchRenderer --out <directory> [options] <files...>\n"
+                 "  --preset <file>        plugin state, XML or the binary blob a host saves\n"
+                 "  --set <id>=<value>     parameter value in its own units, choices by index\n"
+                 "  --format wav|aiff|flac output format, defaults to the input's\n"
+                 "  --block <samples>      processBlock size, default 512\n"
+                 "  --jobs <count>         worker threads, default one per core\n"
+                 "  --list                 print the parameter ids and ranges\n";
+}
+
+void listParameters() {
+    APSatur processor;
+    for (auto* parameter : processor.getParameters()) {
+        if (auto* ranged = dynamic_cast<juce::RangedAudioParameter*>(parameter)) {
+            const auto& range = ranged->getNormalisableRange();
+            std::cout << ranged->getParameterID() << "  " << ranged->getName(64)
+                      << "  [" << range.start << ", " << range.end << "]" << std::endl;
+        }
+    }
+}
+
+bool applySettings(APSatur& processor, const Settings& settings) {
+    if (settings.preset != juce::File()) {
+        juce::MemoryBlock data;
+        if (!settings.preset.loadFileAsData(data)) {
+            printLine("Can't read preset " + settings.preset.getFullPathName(), true);
+            return false;
+        }
+
+        if (auto xml = juce::parseXML(data.toString()))
+            processor.apvts.replaceState(juce::ValueTree::fromXml(*xml));
+        else
+            processor.setStateInformation(data.getData(), static_cast<int>(data.getSize()));
+    }
+
+    for (const auto& id : settings.parameters.getAllKeys()) {
+        auto* parameter = processor.apvts.getParameter(id);
+        if (parameter == nullptr) {
+            printLine("Unknown parameter " + id + ", see --list", true);
+            return false;
+        }
+        const float value = settings.parameters[id].getFloatValue();
+        parameter->setValueNotifyingHost(parameter->convertTo0to1(value));
+    }
+
+    return true;
+}
+
+bool renderFile(APSatur& processor, juce::AudioFormatManager& formats, const juce::File& input, const Settings& settings) {
+    std::unique_ptr<juce::AudioFormatReader> reader(formats.createReaderFor(input));
+    if (reader == nullptr) {
+        printLine("Can't open " + input.getFullPathName(), true);
+        return false;
+    }
+
+    const juce::String extension = settings.format.isEmpty() ? input.getFileExtension() : "." + settings.format;
+    juce::AudioFormat* format = formats.findFormatForFileExtension(extension);
+    if (format == nullptr) {
+        printLine("No writer for " + extension, true);
+        return false;
+    }
+
+    const int channels = static_cast<int>(reader->numChannels);
+    const double sampleRate = reader->sampleRate;
+    const juce::int64 length = reader->lengthInSamples;
+
+    // Float sources stay float where the format allows it, FLAC stops at 24 bits
+    int bits = static_cast<int>(reader->bitsPerSample);
+    if (format->getFormatName().containsIgnoreCase("flac")) bits = std::min(bits, 24);
+
+    const juce::File output = settings.outputDirectory.getChildFile(input.getFileNameWithoutExtension() + extension);
+    output.deleteFile();
+
+    std::unique_ptr<juce::FileOutputStream> stream(output.createOutputStream());
+    if (stream == nullptr) {
+        printLine("Can't write " + output.getFullPathName(), true);
+        return false;
+    }
+
+    std::unique_ptr<juce::AudioFormatWriter> writer(format->createWriterFor(stream.get(), sampleRate,
+                                                                            static_cast<unsigned int>(channels), bits,
+                                                                            reader->metadataValues, 0));
+    if (writer == nullptr) {
+        printLine("Can't write " + juce::String(bits) + " bit " + format->getFormatName(), true);
+        return false;
+    }
+    stream.release();
+
+    processor.setPlayConfigDetails(channels, channels, sampleRate, settings.blockSize);
+    processor.setNonRealtime(true);
+    processor.prepareToPlay(sampleRate, settings.blockSize);
+
+    const juce::int64 latency = processor.getLatencySamples();
+
+    juce::AudioBuffer<float> chunk(channels, chunkSize);
+    juce::MidiBuffer midi;
+
+    const double start = juce::Time::getMillisecondCounterHiRes();
+
+    // Reading past the end returns silence, which flushes the latency out
+    for (juce::int64 position = 0; position < length + latency; position += chunkSize) {
+        const int count = static_cast<int>(std::min<juce::int64>(chunkSize, length + latency - position));
+        reader->read(&chunk, 0, count, position, true, true);
+
+        for (int offset = 0; offset < count; offset += settings.blockSize) {
+            juce::AudioBuffer<float> block(chunk.getArrayOfWritePointers(), channels, offset,
+                                           std::min(settings.blockSize, count - offset));
+            processor.processBlock(block, midi);
+        }
+
+        // Output sample t is input sample t - latency
+        const juce::int64 skip = std::max<juce::int64>(0, latency - position);
+        const juce::int64 keep = std::min<juce::int64>(count, length + latency - position) - skip;
+        if (keep > 0) writer->writeFromAudioSampleBuffer(chunk, static_cast<int>(skip), static_cast<int>(keep));
+    }
+
+    writer.reset();
+    processor.releaseResources();
+
+    const double seconds = (juce::Time::getMillisecondCounterHiRes() - start) / 1000;
+    const double duration = static_cast<double>(length) / sampleRate;
+
+    printLine(input.getFileName() + " : " + juce::String(duration, 2) + " s in " + juce::String(seconds, 2)
+              + " s, " + juce::String(duration / std::max(seconds, 1e-9), 1) + "x real time");
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+    Settings settings;
+    juce::Array<juce::File> inputs;
+
+    for (int i = 1; i < argc; i++) {
+        const juce::String argument(argv[i]);
+        const bool hasValue = i + 1 < argc;
+
+        if (argument == "--list") {
+            listParameters();
+            return 0;
+        } else if (argument == "--out" && hasValue) {
+            settings.outputDirectory = juce::File::getCurrentWorkingDirectory().getChildFile(argv[++i]);
+        } else if (argument == "--preset" && hasValue) {
+            settings.preset = juce::File::getCurrentWorkingDirectory().getChildFile(argv[++i]);
+        } else if (argument == "--set" && hasValue) {
+            const juce::String assignment(argv[++i]);
+            settings.parameters.set(assignment.upToFirstOccurrenceOf("=", false, false),
+                                    assignment.fromFirstOccurrenceOf("=", false, false));
+        } else if (argument == "--format" && hasValue) {
+            settings.format = juce::String(argv[++i]).toLowerCase();
+        } else if (argument == "--block" && hasValue) {
+            settings.blockSize = std::max(1, juce::String(argv[++i]).getIntValue());
+        } else if (argument == "--jobs" && hasValue) {
+            settings.jobs = juce::String(argv[++i]).getIntValue();
+        } else if (argument.startsWith("--")) {
+            printUsage();
+            return 1;
+        } else {
+            inputs.add(juce::File::getCurrentWorkingDirectory().getChildFile(argument));
+        }
+    }
+
+    if (inputs.size() == 0 || settings.outputDirectory == juce::File()) {
+        printUsage();
+        return 1;
+    }
+    settings.outputDirectory.createDirectory();
+
+    const int jobs = std::min(inputs.size(), settings.jobs > 0 ? settings.jobs : juce::SystemStats::getNumCpus());
+
+    // Processors are built here, on the message thread, and only processed on the workers
+    std::vector<std::unique_ptr<APSatur>> processors;
+    for (int i = 0; i < jobs; i++) {
+        processors.push_back(std::make_unique<APSatur>());
+        if (!applySettings(*processors.back(), settings)) return 1;
+    }
+
+    std::atomic<int> next { 0 };
+    std::atomic<int> failures { 0 };
+    std::vector<std::thread> workers;
+
+    for (int i = 0; i < jobs; i++) {
+        workers.emplace_back([&, i] {
+            juce::AudioFormatManager formats;
+            formats.registerBasicFormats();
+
+            for (int file = next++; file < inputs.size(); file = next++)
+                if (!renderFile(*processors[static_cast<size_t>(i)], formats, inputs[file], settings)) failures++;
+        });
+    }
+
+    for (auto& worker : workers) worker.join();
+
+    return failures > 0 ? 1 : 0;
+}
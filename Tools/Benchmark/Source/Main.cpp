@@ -0,0 +1,336 @@
+#include <algorithm>
+#include <functional>
+#include <iostream>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+#include <JuceHeader.h>
+
+#if JUCE_INTEL
+ #if JUCE_MSVC
+  #include <intrin.h>
+ #else
+  #include <x86intrin.h>
+ #endif
+#endif
+
+#include "../../../Source/APCommon.h"
+#include "../../../Source/PluginProcessor.h"
+
+/**
+ * Microbenchmarks for the curves, the analog models, the oversampling engines and
+ * APSatur::processBlock.
+ *
+ * Every figure is per channel sample at the rate the code runs at (base rate for
+ * oversampling and processBlock). Each case is warmed up, then timed over several
+ * rounds of at least --time / rounds seconds and the fastest round is kept, which
+ * is the least disturbed by the scheduler.
+ * Cycles come from the time stamp counter, which ticks at a constant rate on current
+ * x86 parts rather than at the core clock, and are left empty elsewhere.
+ */
+
+namespace {
+
+struct Result {
+    juce::String benchmark, variant;
+    int blockSize = 0, channels = 0;
+    double sampleRate = 0;
+    double nsPerSample = 0, cyclesPerSample = -1;
+};
+
+struct Options {
+    double seconds = .2;
+    juce::String filter;
+    juce::StringPairArray parameters;
+};
+
+constexpr int rounds = 5;
+
+inline juce::uint64 readCycleCounter() {
+   #if JUCE_INTEL
+    return __rdtsc();
+   #else
+    return 0;
+   #endif
+}
+
+Result measure(const Options& options, const std::function<void()>& body, size_t samplesPerCall) {
+    for (int i = 0; i < 3; i++) body();
+
+    Result result;
+    result.nsPerSample = 1e300;
+
+    for (int round = 0; round < rounds; round++) {
+        size_t calls = 0;
+        const juce::uint64 cycles = readCycleCounter();
+        const juce::int64 start = juce::Time::getHighResolutionTicks();
+        double elapsed = 0;
+
+        do {
+            body();
+            calls++;
+            elapsed = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start);
+        } while (elapsed < options.seconds / rounds);
+
+        const double samples = static_cast<double>(calls * samplesPerCall);
+        const double ns = elapsed * 1e9 / samples;
+        if (ns < result.nsPerSample) {
+            result.nsPerSample = ns;
+           #if JUCE_INTEL
+            result.cyclesPerSample = static_cast<double>(readCycleCounter() - cycles) / samples;
+           #else
+            juce::ignoreUnused(cycles);
+           #endif
+        }
+    }
+
+    return result;
+}
+
+bool isSelected(const Options& options, const juce::String& name) {
+    return options.filter.isEmpty() || name.contains(options.filter);
+}
+
+// Full scale noise and a louder sine, so every branch of the curves gets exercised
+std::vector<float> makeInput(size_t length) {
+    std::vector<float> input(length);
+    juce::Random random(1);
+    for (size_t i = 0; i < length; i++)
+        input[i] = 4.0f * std::sin(.01f * static_cast<float>(i)) + random.nextFloat() * 2 - 1;
+    return input;
+}
+
+template <float (*Func)(float)>
+void benchmarkCurve(const Options& options, const char* name, std::vector<Result>& results) {
+    if (!isSelected(options, juce::String("curve/") + name)) return;
+
+    constexpr size_t length = 4096;
+    const std::vector<float> input = makeInput(length);
+    std::vector<float> samples(length);
+
+    static SaturationTables tables;
+    tables.build();
+    const AntiderivativeTables& antiderivatives = AntiderivativeTables::getInstance();
+    ADAAChannelState state;
+
+    // Every call restores the input first, the copy costs well under .1 ns per sample
+    const std::pair<const char*, std::function<void()>> variants[] = {
+        { "reference", [&] { std::copy(input.begin(), input.end(), samples.begin()); performSaturation<Func>(samples.data(), length); } },
+        { "simd", [&] { std::copy(input.begin(), input.end(), samples.begin()); performSaturationSIMD<Func>(samples.data(), length); } },
+        { "table linear", [&] { std::copy(input.begin(), input.end(), samples.begin()); performSaturationTable<Func, TableInterpolation::linear>(tables, samples.data(), length); } },
+        { "table cubic", [&] { std::copy(input.begin(), input.end(), samples.begin()); performSaturationTable<Func, TableInterpolation::cubic>(tables, samples.data(), length); } },
+        { "adaa1", [&] { std::copy(input.begin(), input.end(), samples.begin()); performSaturationADAA1<Func>(antiderivatives, state, samples.data(), length); } },
+        { "adaa2", [&] { std::copy(input.begin(), input.end(), samples.begin()); performSaturationADAA2<Func>(antiderivatives, state, samples.data(), length); } },
+    };
+
+    for (const auto& variant : variants) {
+        Result result = measure(options, variant.second, length);
+        result.benchmark = juce::String("curve/") + name;
+        result.variant = variant.first;
+        result.blockSize = static_cast<int>(length);
+        result.channels = 1;
+        results.push_back(result);
+    }
+}
+
+// Every curve of the registry, so new ones get benchmarked without touching this file
+template <int index = 0>
+void benchmarkCurves(const Options& options, std::vector<Result>& results) {
+    if constexpr (index < numCurves) {
+        benchmarkCurve<curveRegistry[index].function>(options, curveRegistry[index].name, results);
+        benchmarkCurves<index + 1>(options, results);
+    }
+}
+
+// Per oversampled sample at 8x of 44.1 kHz, the louder input keeps every diode sample past its table
+void benchmarkModels(const Options& options, std::vector<Result>& results) {
+    constexpr size_t length = 4096;
+    constexpr double sampleRate = 44100.0 * 8;
+
+    std::vector<float> input = makeInput(length);
+    std::vector<float> loud(input);
+    for (float& sample : loud) sample *= 1000;
+    std::vector<float> samples(length);
+
+    DiodeClipper diode;
+    diode.build(sampleRate);
+    float diodeState = 0;
+    TapeHysteresis::State tapeState;
+
+    const std::tuple<const char*, const char*, std::function<void()>> cases[] = {
+        { "model/diode clipper", "table", [&] { std::copy(input.begin(), input.end(), samples.begin()); diode.process(diodeState, samples.data(), length); } },
+        { "model/diode clipper", "newton", [&] { std::copy(loud.begin(), loud.end(), samples.begin()); diode.process(diodeState, samples.data(), length); } },
+        { "model/tape hysteresis", "rk2", [&] { std::copy(input.begin(), input.end(), samples.begin()); TapeHysteresis::process(tapeState, samples.data(), length); } },
+    };
+
+    for (const auto& [name, variant, body] : cases) {
+        if (!isSelected(options, name)) continue;
+
+        Result result = measure(options, body, length);
+        result.benchmark = name;
+        result.variant = variant;
+        result.blockSize = static_cast<int>(length);
+        result.channels = 1;
+        result.sampleRate = sampleRate;
+        results.push_back(result);
+    }
+}
+
+void benchmarkOversampling(const Options& options, std::vector<Result>& results) {
+    constexpr int blockSize = 512;
+    constexpr int channels = 2;
+
+    const std::pair<OversamplingFilter, const char*> filters[] = {
+        { OversamplingFilter::firEquiripple, "fir" },
+        { OversamplingFilter::iirPolyphase, "iir" },
+        { OversamplingFilter::iirLowLatency, "iir low latency" },
+    };
+
+    const std::vector<float> input = makeInput(blockSize);
+    juce::AudioBuffer<float> buffer(channels, blockSize);
+
+    for (const auto& filter : filters) {
+        for (int stages = 1; stages <= 4; stages++) {
+            const juce::String name = "oversampling/" + juce::String(1 << stages) + "x";
+            if (!isSelected(options, name)) continue;
+
+            OversamplerHandoff handoff;
+            handoff.prepare(stages, filter.first, channels, blockSize);
+            bool changed;
+            OversamplerEngine* engine = handoff.acquire(changed);
+
+            for (int channel = 0; channel < channels; channel++)
+                std::copy(input.begin(), input.end(), buffer.getWritePointer(channel));
+            juce::dsp::AudioBlock<float> block(buffer);
+
+            Result up = measure(options, [&] { engine->processSamplesUp(block); }, blockSize * channels);
+            Result down = measure(options, [&] { engine->processSamplesDown(block); }, blockSize * channels);
+
+            for (Result* result : { &up, &down }) {
+                result->benchmark = name;
+                result->variant = juce::String(filter.second) + (result == &up ? " up" : " down");
+                result->blockSize = blockSize;
+                result->channels = channels;
+                results.push_back(*result);
+            }
+        }
+    }
+}
+
+template <typename Sample>
+Result measureProcessBlock(const Options& options, double sampleRate, int channels, int blockSize) {
+    APSatur processor;
+    for (const auto& id : options.parameters.getAllKeys())
+        if (auto* parameter = processor.apvts.getParameter(id))
+            parameter->setValueNotifyingHost(parameter->convertTo0to1(options.parameters[id].getFloatValue()));
+
+    processor.setProcessingPrecision(std::is_same_v<Sample, double> ? juce::AudioProcessor::doublePrecision
+                                                                    : juce::AudioProcessor::singlePrecision);
+    processor.setPlayConfigDetails(channels, channels, sampleRate, blockSize);
+    processor.prepareToPlay(sampleRate, blockSize);
+
+    const std::vector<float> input = makeInput(static_cast<size_t>(blockSize));
+    juce::AudioBuffer<Sample> buffer(channels, blockSize);
+    juce::MidiBuffer midi;
+
+    Result result = measure(options, [&] {
+        for (int channel = 0; channel < channels; channel++)
+            std::copy(input.begin(), input.end(), buffer.getWritePointer(channel));
+        processor.processBlock(buffer, midi);
+    }, static_cast<size_t>(blockSize * channels));
+
+    result.benchmark = "processBlock";
+    result.variant = std::is_same_v<Sample, double> ? "double" : "default";
+    result.blockSize = blockSize;
+    result.channels = channels;
+    result.sampleRate = sampleRate;
+
+    processor.releaseResources();
+    return result;
+}
+
+void benchmarkProcessBlock(const Options& options, std::vector<Result>& results) {
+    if (!isSelected(options, "processBlock")) return;
+
+    for (double sampleRate : { 44100.0, 48000.0, 96000.0 }) {
+        for (int channels : { 1, 2, 8 }) {
+            for (int blockSize = 16; blockSize <= 4096; blockSize *= 2) {
+                results.push_back(measureProcessBlock<float>(options, sampleRate, channels, blockSize));
+                results.push_back(measureProcessBlock<double>(options, sampleRate, channels, blockSize));
+            }
+        }
+    }
+}
+
+juce::String toJSON(const std::vector<Result>& results) {
+    juce::String json = "[\n";
+    for (size_t i = 0; i < results.size(); i++) {
+        const Result& r = results[i];
+        json << "  { \"benchmark\": \"" << r.benchmark << "\", \"variant\": \"" << r.variant
+             << "\", \"blockSize\": " << r.blockSize << ", \"channels\": " << r.channels
+             << ", \"sampleRate\": " << r.sampleRate
+             << ", \"nsPerSample\": " << juce::String(r.nsPerSample, 4)
+             << ", \"cyclesPerSample\": " << (r.cyclesPerSample < 0 ? juce::String("null") : juce::String(r.cyclesPerSample, 3))
+             << " }" << (i + 1 < results.size() ? ",\n" : "\n");
+    }
+    return json + "]\n";
+}
+
+juce::String toCSV(const std::vector<Result>& results) {
+    juce::String csv = "benchmark,variant,blockSize,channels,sampleRate,nsPerSample,cyclesPerSample\n";
+    for (const Result& r : results) {
+        csv << r.benchmark << "," << r.variant << "," << r.blockSize << "," << r.channels << ","
+            << r.sampleRate << "," << juce::String(r.nsPerSample, 4) << ","
+            << (r.cyclesPerSample < 0 ? juce::String() : juce::String(r.cyclesPerSample, 3)) << "\n";
+    }
+    return csv;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+    Options options;
+    juce::String format = "json";
+    juce::File output;
+
+    for (int i = 1; i < argc; i++) {
+        const juce::String argument(argv[i]);
+        const bool hasValue = i + 1 < argc;
+
+        if (argument == "--format" && hasValue) {
+            format = juce::String(argv[++i]).toLowerCase();
+        } else if (argument == "--out" && hasValue) {
+            output = juce::File::getCurrentWorkingDirectory().getChildFile(argv[++i]);
+        } else if (argument == "--time" && hasValue) {
+            options.seconds = std::max(.01, juce::String(argv[++i]).getDoubleValue());
+        } else if (argument == "--filter" && hasValue) {
+            options.filter = argv[++i];
+        } else if (argument == "--set" && hasValue) {
+            const juce::String assignment(argv[++i]);
+            options.parameters.set(assignment.upToFirstOccurrenceOf("=", false, false),
+                                   assignment.fromFirstOccurrenceOf("=", false, false));
+        } else {
+            std::cout << "Usage: Benchmark [--format json|csv] [--out <file>] [--time <seconds per case>]\n"
+                         "                 [--filter <substring>] [--set <id>=<value>]\n";
+            return argument == "--help" ? 0 : 1;
+        }
+    }
+
+    std::vector<Result> results;
+
+    benchmarkCurves(options, results);
+    benchmarkModels(options, results);
+    benchmarkOversampling(options, results);
+    benchmarkProcessBlock(options, results);
+
+    const juce::String report = format == "csv" ? toCSV(results) : toJSON(results);
+
+    if (output == juce::File())
+        std::cout << report;
+    else if (!output.replaceWithText(report))
+        return 1;
+
+    return 0;
+}